@@ -58,8 +58,10 @@ static void (_interrupt _far *OldInt8)(void);
 
 static volatile int32_t TaskServiceRate  = 0x10000L;
 static volatile int32_t TaskServiceCount = 0;
+static volatile uint64_t TaskServiceTicks = 0;
 
 static boolean TS_Installed = false;
+static boolean TS_CountByOne = false;
 
 
 /*---------------------------------------------------------------------
@@ -106,7 +108,9 @@ static void TS_SetClockSpeed(int32_t speed)
 	else
 		TaskServiceRate = 0x10000L;
 
-	outp(0x43, 0x36);
+	// mode 2 counts down by one, so TS_GetTicks can read the counter,
+	// otherwise the timer stays in mode 3 like the BIOS sets it
+	outp(0x43, TS_CountByOne ? 0x34 : 0x36);
 	outp(0x40, LOBYTE(TaskServiceRate));
 	outp(0x40, HIBYTE(TaskServiceRate));
 
@@ -196,6 +200,7 @@ static void _interrupt _far TS_ServiceSchedule (void)
 		ptr = next;
 	}
 
+	TaskServiceTicks += TaskServiceRate;
 	TaskServiceCount += TaskServiceRate;
 	if (TaskServiceCount > 0xffffL)
 	{
@@ -210,6 +215,59 @@ static void _interrupt _far TS_ServiceSchedule (void)
 }
 
 
+/*---------------------------------------------------------------------
+   Function: TS_EnableTickCounter
+
+   Runs the 8253 in mode 2 from TS_Startup on, so TS_GetTicks can
+   read the counter. Only benchmark runs need it.
+---------------------------------------------------------------------*/
+
+void TS_EnableTickCounter(void)
+{
+	TS_CountByOne = true;
+}
+
+
+/*---------------------------------------------------------------------
+   Function: TS_GetTicks
+
+   Returns the number of 8253 ticks (1193182 Hz) since TS_Startup.
+   Without TS_EnableTickCounter it only counts whole interrupts.
+---------------------------------------------------------------------*/
+
+uint64_t TS_GetTicks(void)
+{
+	uint64_t ticks;
+	int32_t  count;
+
+	uint32_t flags = DisableInterrupts();
+
+	if (!TS_CountByOne)
+	{
+		ticks = TaskServiceTicks;
+		RestoreInterrupts(flags);
+		return ticks;
+	}
+
+	outp(0x43, 0x00);	// latch counter 0
+	count  = inp(0x40);
+	count |= inp(0x40) << 8;
+	if (count == 0)
+		count = 0x10000L;
+
+	ticks = TaskServiceTicks + TaskServiceRate - count;
+
+	// the counter has reloaded, but the interrupt is still pending
+	outp(0x20, 0x0a);
+	if ((inp(0x20) & 1) && count > TaskServiceRate / 2)
+		ticks += TaskServiceRate;
+
+	RestoreInterrupts(flags);
+
+	return ticks;
+}
+
+
 /*---------------------------------------------------------------------
    Function: TS_Startup
 
@@ -227,6 +285,7 @@ static void TS_Startup(void)
 
 		TaskServiceRate  = 0x10000L;
 		TaskServiceCount = 0;
+		TaskServiceTicks = 0;
 
 		replaceInterrupt(OldInt8, NewInt8, TIMERINT, TS_ServiceSchedule);
 
@@ -247,6 +306,7 @@ void TS_Shutdown(void)
 	{
 		TS_FreeTaskList();
 
+		TS_CountByOne = false;	// the BIOS runs the 8253 in mode 3
 		TS_SetClockSpeed(0);
 
 		restoreInterrupt(TIMERINT, OldInt8, NewInt8);
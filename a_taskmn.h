@@ -48,5 +48,7 @@ task *TS_ScheduleTask(void (*Function)(task *), int32_t rate, int32_t priority);
 void TS_Terminate(task *ptr);
 void TS_Dispatch(void);
 void TS_SetTaskRate(task *Task, int32_t rate);
+void TS_EnableTickCounter(void);
+uint64_t TS_GetTicks(void);
 
 #endif
@@ -56,3 +56,13 @@ void TSM_Remove(void)
 {
 	TS_Shutdown();
 }
+
+void TSM_EnableTickCounter(void)
+{
+	TS_EnableTickCounter();
+}
+
+uint64_t TSM_GetTicks(void)
+{
+	return TS_GetTicks();
+}
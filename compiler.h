@@ -174,6 +174,45 @@ fixed_t	FixedDiv2 (fixed_t a, fixed_t b);
 
 
 
+#elif defined __linux__
+//Headless POSIX build for benchmarking, see i_posix.c
+#include <strings.h>
+
+#define mkdir(x) mkdir(x,0755)
+
+//There are no VGA ports, the video memory is a plain buffer
+#define inp(port)			0
+#define outp(port,data)		((void)0)
+#define outpw(port,data)	((void)0)
+
+extern uint8_t *I_VideoMemory;
+#define __djgpp_conventional_base ((intptr_t)I_VideoMemory - 0xa0000)
+
+#define _interrupt
+#define _far
+
+#define O_BINARY 0
+#define stricmp strcasecmp
+#define strnicmp strncasecmp
+
+char *strupr (char *s);
+int32_t filelength (int32_t handle);
+
+//-threads draws the view with several threads, see R_DrawRecords
+#define RENDER_THREADS
+#define THREADLOCAL	__thread
+
+//-resolution renders the view at a multiple of 320x200, see R_SetResolution
+#if defined LINEAR_FRAMEBUFFER
+#define RENDER_RESOLUTION
+#endif
+
+
+
+#endif
+
+#if !defined THREADLOCAL
+#define THREADLOCAL
 #endif
 
 #endif
@@ -20,9 +20,11 @@
 
 #include <sys/stat.h>
 #include <unistd.h>
+#if !defined __linux__
 #include <direct.h>
 #include <io.h>
 #include <dos.h>
+#endif
 #include "doomdef.h"
 #include "soundst.h"
 #include "dutils.h"
@@ -277,6 +279,8 @@ static void D_Display (void)
 	boolean wipe;
 	boolean redrawsbar;
 
+	M_BenchFrame ();
+
 	if (nodrawers)
 		return;                    // for comparative timing / profiling
 
@@ -312,12 +316,14 @@ static void D_Display (void)
 			break;
 		if (automapactive)
 			AM_Drawer ();
-		if (wipe || (viewheight != SCREENHEIGHT && fullscreen) )
+		if (wipe || (scaledviewheight != SCREENHEIGHT && fullscreen) )
 			redrawsbar = true;
 		if (inhelpscreensstate && !inhelpscreens)
 			redrawsbar = true;              // just put away the help screen
-		ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
-		fullscreen = viewheight == SCREENHEIGHT;
+		M_ProfileStart (prof_hud);
+		ST_Drawer (scaledviewheight == SCREENHEIGHT, redrawsbar );
+		M_ProfileStop (prof_hud);
+		fullscreen = scaledviewheight == SCREENHEIGHT;
 		break;
 	case GS_INTERMISSION:
 		WI_Drawer  ();
@@ -331,14 +337,20 @@ static void D_Display (void)
 	}
     
 	// draw buffered stuff to screen
+	M_ProfileStart (prof_present);
 	I_UpdateNoBlit ();
+	M_ProfileStop (prof_present);
 	
 	// draw the view directly
 	if (gamestate == GS_LEVEL && !automapactive && gametic)
 		R_RenderPlayerView (&players[displayplayer]);
 	
 	if (gamestate == GS_LEVEL && gametic)
+	{
+		M_ProfileStart (prof_hud);
 		HU_Drawer ();
+		M_ProfileStop (prof_hud);
+	}
 	
 	// clean up border stuff
 	if (gamestate != oldgamestate && gamestate != GS_LEVEL)
@@ -380,6 +392,9 @@ static void D_Display (void)
 	}
 	
 	
+	if (gamestate == GS_LEVEL && gametic)
+		M_ProfileDrawer ();
+
 	// menus go directly to the screen
 	M_Drawer ();          // menu is drawn even on top of everything
 	NetUpdate ();         // send out any new accumulation
@@ -388,7 +403,9 @@ static void D_Display (void)
 	// normal update
 	if (!wipe)
 	{
+		M_ProfileStart (prof_present);
 		I_FinishUpdate ();              // page flip or blit buffer
+		M_ProfileStop (prof_present);
 		return;
 	}
 	
@@ -406,6 +423,7 @@ static void D_Display (void)
 		} while (!tics);
 		wipestart = nowtime;
 		done = wipe_ScreenWipe(tics);
+		W_PrefetchTic ();
 		I_UpdateNoBlit ();
 		M_Drawer ();                            // menu is drawn even on top of wipes
 		I_FinishUpdate ();                      // page flip or blit buffer
@@ -458,7 +476,9 @@ static void _Noreturn D_DoomLoop(void)
 		}
 
 		// move positional sounds
+		M_ProfileStart (prof_sound);
 		S_UpdateSounds(players[consoleplayer].mo);
+		M_ProfileStop (prof_sound);
 		D_Display();
 	}
 }
@@ -605,6 +625,12 @@ void D_StartTitle (void)
 
 static char title[128]; //      print title for every printed line
 
+#if defined __linux__
+void mprintf(char *msg)
+{
+	printf("%s", msg);
+}
+#else
 static int32_t GetTextX(void)
 {
 	union REGS regs;
@@ -675,6 +701,7 @@ void mprintf(char *msg)
 
 	SetTextPos(x, y);
 }
+#endif
 
 /*
 ===============
@@ -950,7 +977,9 @@ static void FindResponseFile (void)
 
 void D_DoomMain (void)
 {
+#if !defined __linux__
 	union REGS regs;
+#endif
 	int32_t p;
 	char file[256];
 
@@ -965,6 +994,21 @@ void D_DoomMain (void)
 	respawnparm = M_CheckParm ("-respawn");
 	fastparm = M_CheckParm ("-fast");
 	devparm = M_CheckParm ("-devparm");
+	profiling = M_CheckParm ("-profile");
+	showlumpstats = M_CheckParm ("-lumpstats");
+#if defined RENDER_THREADS
+	p = M_CheckParm ("-threads");
+	if (p && p < myargc-1)
+		renderthreads = atoi (myargv[p+1]);
+#endif
+#if defined RENDER_RESOLUTION
+	p = M_CheckParm ("-resolution");
+	if (p && p < myargc-1)
+		R_SetResolution (myargv[p+1]);
+#endif
+	p = M_CheckParm ("-checksum");
+	if (p && p < myargc-1)
+		P_ChecksumTrace (myargv[p+1]);
 #if !APPVER_CHEX
 	if (M_CheckParm ("-altdeath"))
 		deathmatch = 2;
@@ -1047,11 +1091,15 @@ void D_DoomMain (void)
 				 VERSION/100,VERSION%100);
 	}
 
+#if defined __linux__
+	printf ("%s\n", title);
+#else
 	regs.h.ah = 0;
 	regs.h.al = 3;
 	int386 (0x10, &regs, &regs);
 
 	tprintf (title, FGCOLOR, BGCOLOR);
+#endif
 
 #if (APPVER_DOOMREV < AV_DR_DM19)
 	printf ("\n");
@@ -1146,6 +1194,15 @@ void D_DoomMain (void)
 		D_AddFile (file);
 		printf("Playing demo %s.lmp.\n",myargv[p+1]);
 	}
+
+	p = M_CheckParm ("-batchdemo");
+	if (p)
+	{
+		// demo lumps, or .lmp files
+		while (++p != myargc && myargv[p][0] != '-')
+			if (strlen (myargv[p]) > 4 && !stricmp (myargv[p] + strlen (myargv[p]) - 4, ".lmp"))
+				D_AddFile (myargv[p]);
+	}
 	
 	// get skill / episode / map from parms
 	startskill = sk_medium;
@@ -1331,7 +1388,7 @@ void D_DoomMain (void)
 		// for statistics driver
 		extern void* statcopy;                            
 	
-		statcopy = (void*)atoi(myargv[p+1]);
+		statcopy = (void*)(intptr_t)atoi(myargv[p+1]);
 		mprintf ("External statistics registered.\n");
 	}
 	
@@ -1358,6 +1415,15 @@ void D_DoomMain (void)
 		G_TimeDemo (myargv[p+1]);
 		D_DoomLoop ();  // never returns
 	}
+
+	p = M_CheckParm ("-batchdemo");
+	if (p)
+	{
+		if (p == myargc-1 || myargv[p+1][0] == '-')
+			I_Error ("-batchdemo needs at least one demo");
+		G_BatchDemo (p);
+		D_DoomLoop ();  // never returns
+	}
 	
 	p = M_CheckParm ("-loadgame");
 	if (p && p < myargc-1)
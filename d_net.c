@@ -74,7 +74,7 @@ static doomdata_t              reboundstore;
 
 static int32_t     NetbufferSize (void)
 {
-	return (int32_t)&(((doomdata_t *)0)->cmds[netbuffer->numtics]);
+	return (int32_t)(offsetof(doomdata_t, cmds) + netbuffer->numtics * sizeof(ticcmd_t));
 }
 
 static uint32_t NetbufferChecksum (void)
@@ -84,7 +84,7 @@ static uint32_t NetbufferChecksum (void)
 
 	c = 0x1234567;
 
-	l = (NetbufferSize () - (int32_t)&(((doomdata_t *)0)->retransmitfrom))/4;
+	l = (NetbufferSize () - (int32_t)offsetof(doomdata_t, retransmitfrom))/4;
 	for (i=0 ; i<l ; i++)
 		c += ((uint32_t *)&netbuffer->retransmitfrom)[i] * (i+1);
 
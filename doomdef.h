@@ -592,6 +592,7 @@ extern int32_t ticdup;
 
 #define	MAXNETNODES		8
 extern int32_t rndindex;
+extern int32_t prndindex;
 extern int32_t gametic, maketic;
 
 #define SAVEGAMESIZE 0x2c000
@@ -607,6 +608,7 @@ extern int32_t viewwindowy;
 extern int32_t viewwidth;
 extern int32_t scaledviewwidth;
 extern int32_t viewheight;
+extern int32_t scaledviewheight;
 
 extern int32_t mouseSensitivity;
 
@@ -670,10 +672,15 @@ int32_t LongSwap(int32_t);
 
 void	Z_Init (void);
 void 	*Z_Malloc (int32_t size, int32_t tag, void *ptr);
+void	*Z_MallocLevel (int32_t size);
 void 	Z_Free (void *ptr);
 void 	Z_FreeTags (int32_t lowtag, int32_t hightag);
 void	Z_CheckHeap (void);
 void	Z_ChangeTag2 (void *ptr, int32_t tag);
+void	Z_Touch (void *ptr);
+void	Z_DumpHeap (char *filename);
+void	Z_SetPurgeHook (void (*hook) (void));
+// the hook is called before Z_Malloc purges cache blocks
 
 
 typedef struct memblock_s
@@ -683,14 +690,30 @@ typedef struct memblock_s
 	int32_t                     tag;            // purgelevel
 	int32_t                     id;                     // should be ZONEID
 	struct memblock_s       *next, *prev;
+	struct memblock_s       *lrunext, *lruprev;     // purgable blocks, the least recently used first
 } memblock_t;
 
+#if defined MMAP_WADS
+boolean	Z_IsZoneMemory (void *ptr);
+// lumps in a mapped WAD file aren't zone blocks, Z_Free and Z_ChangeTag ignore them
+
 #define Z_ChangeTag(p,t) \
 { \
+if (Z_IsZoneMemory(p)) \
+{ \
 if (( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
 	I_Error("Z_CT at "__FILE__":%i",__LINE__); \
 Z_ChangeTag2(p,t); \
+} \
 };
+#else
+#define Z_ChangeTag(p,t) \
+{ \
+if (( (memblock_t *)( (byte *)(p) - sizeof(memblock_t)))->id!=0x1d4a11) \
+	I_Error("Z_CT at "__FILE__":%i",__LINE__); \
+Z_ChangeTag2(p,t); \
+};
+#endif
 
 //-------
 //WADFILE
@@ -699,9 +722,11 @@ typedef struct
 {
 	char		name[8];
 	int32_t		handle,position,size;
+	boolean		compressed;		// LZ4 block, size is the uncompressed size
 } lumpinfo_t;
 
 extern lumpinfo_t *lumpinfo;
+extern int32_t numlumps;
 
 void	W_InitMultipleFiles (char **filenames);
 void	W_Reload (void);
@@ -714,6 +739,36 @@ void	W_ReadLump (int32_t lump, void *dest);
 
 void	*W_CacheLumpNum (int32_t lump, int32_t tag);
 void	*W_CacheLumpName (char *name, int32_t tag);
+void	W_CacheLumpBatch (int32_t *lumps, int32_t count, int32_t tag);
+
+typedef enum
+{
+	lc_other,
+	lc_map,
+	lc_flat,
+	lc_patch,
+	lc_sprite,
+	lc_sound,
+	lc_music,
+	NUMLUMPCATEGORIES
+} lumpcategory_t;
+
+typedef struct
+{
+	int32_t		hits, misses, rereads;
+	uint32_t	bytes;					// read from disk
+} lumpstats_t;
+
+extern lumpstats_t	lumpcategorystats[NUMLUMPCATEGORIES];
+extern char *const	lumpcategorynames[NUMLUMPCATEGORIES];
+
+void	W_PrintLumpStats (void);
+// -lumpstats cache statistics, printed on exit
+
+void	W_PrefetchLump (int32_t lump);
+void	W_PrefetchTic (void);
+void	W_ClearPrefetch (void);
+// queues a lump to be read in the background, W_PrefetchTic reads a few every tic
 
 
 
@@ -755,6 +810,29 @@ void D_StartTitle (void);
 #define SCREENHEIGHT 200
 #define PLANEWIDTH	(SCREENWIDTH/4)
 
+// the view is rendered at RENDERWIDTH x RENDERHEIGHT,
+// the 2D layers are drawn at SCREENWIDTH x SCREENHEIGHT
+#if defined RENDER_RESOLUTION
+#define MAXRENDERSCALE	6
+#define MAXRENDERWIDTH	(SCREENWIDTH*MAXRENDERSCALE)
+#define MAXRENDERHEIGHT	(SCREENHEIGHT*MAXRENDERSCALE)
+#define RENDERWIDTH		(SCREENWIDTH*renderscale)
+#define RENDERHEIGHT	(SCREENHEIGHT*renderscale)
+
+extern int32_t renderscale;
+extern byte *renderscreen;
+
+void R_SetResolution (char *resolution);
+// -resolution 1280x800, before R_Init
+void R_DrawScaledFrame (byte *dest);
+// draws screens[0] scaled up to RENDERWIDTH x RENDERHEIGHT, with the view on top
+#else
+#define MAXRENDERWIDTH	SCREENWIDTH
+#define MAXRENDERHEIGHT	SCREENHEIGHT
+#define RENDERWIDTH		SCREENWIDTH
+#define RENDERHEIGHT	SCREENHEIGHT
+#endif
+
 byte *I_ZoneBase (int32_t *size);
 // called by startup code to get the ammount of memory to malloc
 // for the zone management
@@ -763,6 +841,9 @@ int32_t I_GetTime (void);
 // called by D_DoomLoop
 // returns current time in tics
 
+uint32_t I_GetTimeMicros (void);
+// returns current time in microseconds, for profiling
+
 void I_StartFrame (void);
 // called by D_DoomLoop
 // called before processing any tics in a frame (just after displaying a frame)
@@ -795,6 +876,9 @@ void _Noreturn I_Quit (void);
 // called by M_Responder when quit is selected
 // clean exit, displays sell blurb
 
+void _Noreturn I_Exit (void);
+// clean exit at the end of a benchmark, doesn't save the defaults
+
 void I_SetPalette (byte *palette);
 // takes full 8 bit values
 
@@ -810,6 +894,14 @@ void I_ReadScreen (byte *scr);
 void I_BeginRead (void);
 void I_EndRead (void);
 
+#if defined RENDER_THREADS
+int32_t I_StartWorkers (int32_t count);
+void I_RunWorkers (void (*func) (int32_t worker));
+// I_StartWorkers returns the number of worker threads it could start
+// I_RunWorkers runs func on all workers at once and waits for them,
+// the calling thread keeps its own thread local variables
+#endif
+
 ticcmd_t *I_BaseTiccmd(void);
 // Either returns a null ticcmd,
 // or calls a loadable driver to build it.
@@ -844,6 +936,7 @@ void G_BeginRecording (void);
 
 void G_PlayDemo (char *name);
 void G_TimeDemo (char *name);
+void G_BatchDemo (int32_t p);
 void G_CheckDemoStatus (void);
 
 void G_ExitLevel (void);
@@ -868,6 +961,9 @@ void P_Ticker (void);
 void P_SetupLevel (int32_t episode, int32_t map);
 // called by W_Ticker
 
+void P_PrefetchLevel (int32_t episode, int32_t map);
+// called by G_DoCompleted, queues the lumps of the next level
+
 void P_Init (void);
 // called by startup code
 
@@ -881,6 +977,10 @@ void P_ArchiveSpecials (void);
 void P_UnArchiveSpecials (void);
 // load / save game routines
 
+uint32_t P_Checksum (void);
+void P_ChecksumTrace (char *name);
+// hash of the mobjs, sectors and random index, for demo regression tests
+
 //-------
 //REFRESH
 //-------
@@ -900,6 +1000,19 @@ void R_DrawViewBorder (void);
 void R_SetViewSize (int32_t blocks, int32_t detail);
 // called by M_Responder
 
+#if defined LINEAR_FRAMEBUFFER
+void R_FlushColumns (void);
+// draws the batched columns, called when a wall, a sprite or the sky is done
+// and before Z_Malloc purges
+#endif
+
+#if defined RENDER_THREADS
+extern int32_t renderthreads;
+
+void R_DrawRecords (void);
+// draws the recorded columns and spans, also called before Z_Malloc purges
+#endif
+
 int32_t	R_FlatNumForName (char *name);
 
 int32_t	R_TextureNumForName (char *name);
@@ -933,6 +1046,52 @@ void M_ReadFile (char const *name, byte **buffer);
 
 void M_ScreenShot (void);
 
+void M_BenchStart (void);
+void M_BenchFrame (void);
+char *M_BenchReport (void);
+void M_BenchResult (char *name, int32_t gametics, uint32_t time, uint32_t checksum);
+void M_BenchDump (void);
+// -timedemo frame timing, see m_bench.c
+
+typedef enum
+{
+	prof_frame,
+	prof_bsp,
+	prof_planes,
+	prof_masked,
+	prof_records,	// the pixels of the render threads
+	prof_scale,		// the view scaled down to the screen
+	prof_playsim,
+	prof_thinkers,
+	prof_sound,
+	prof_hud,
+	prof_present,
+	NUMPROFILES
+} profile_t;
+
+extern boolean profiling;
+extern boolean showlumpstats;
+
+void M_ProfileStart (profile_t p);
+void M_ProfileStop (profile_t p);
+void M_ProfileDrawer (void);
+// -profile subsystem timers, -lumpstats lump cache statistics
+
+typedef enum
+{
+	pool_drawsegs,
+	pool_vissprites,
+	pool_openings,
+	pool_intercepts,
+	NUMPOOLS
+} pool_t;
+
+void M_PoolUsage (pool_t p, int32_t used);
+void M_PoolOverflow (pool_t p);
+// peak use of the refresh and intercept pools, printed on exit with -profile
+// an overflow is a fixed limit that was hit, or with REMOVE_LIMITS a pool
+// that grew during a frame
+
 void M_LoadDefaults (void);
 
 void M_SaveDefaults (void);
@@ -952,6 +1111,11 @@ void V_DrawPatchDirect(int32_t x, int32_t y, patch_t *patch);
 void V_DrawBlock(byte *src); // Draw a linear block of pixels into the view buffer
 void V_MarkRect(int32_t x, int32_t y, int32_t width, int32_t height);
 
+#if defined RENDER_RESOLUTION
+extern int16_t dirtyleft[SCREENHEIGHT], dirtyright[SCREENHEIGHT];
+void V_ClearDirtyRows(void); // V_MarkRect also marks the columns of every row, for R_DrawScaledFrame
+#endif
+
 /////////////////////////////////////////////////////
 
 //
@@ -399,6 +399,8 @@ static void G_DoLoadLevel (void)
 	P_SetupLevel (gameepisode, gamemap);
 	displayplayer = consoleplayer;      // view the guy you are playing
 	starttime = I_GetTime ();
+	if (timingdemo)
+		M_BenchStart ();
 	gameaction = ga_nothing;
 	Z_CheckHeap ();
 
@@ -665,13 +667,16 @@ void G_Ticker (void)
 	switch (gamestate)
 	{
 		case GS_LEVEL:
+			M_ProfileStart (prof_playsim);
 			P_Ticker ();
+			M_ProfileStop (prof_playsim);
 			ST_Ticker ();
 			AM_Ticker ();
 			HU_Ticker ();
 			break;
 		case GS_INTERMISSION:
 			WI_Ticker ();
+			W_PrefetchTic ();
 			break;
 		case GS_FINALE:
 			F_Ticker ();
@@ -1067,6 +1072,11 @@ static void G_DoCompleted(void)
 		memcpy(statcopy, &wminfo, sizeof(wminfo));
 
 	WI_Start(&wminfo);
+
+	// read the level G_DoWorldDone loads while the intermission runs,
+	// there's none after MAP30
+	if (!commercial || gamemap != 30)
+		P_PrefetchLevel (gameepisode, wminfo.next+1);
 }
 
 //============================================================================
@@ -1338,6 +1348,7 @@ void G_InitNew(skill_t skill, int32_t episode, int32_t map)
 	if(map > 9 && !commercial)
 		map = 9;
 	M_ClearRandom();
+	W_ClearPrefetch();
 	if(skill == sk_nightmare || respawnparm)
 	{
 		respawnmonsters = true;
@@ -1520,6 +1531,8 @@ void G_BeginRecording(void)
 */
 
 static char    *defdemoname;
+static int32_t demostarttic;
+static uint32_t demostarttime;
 
 void G_DeferedPlayDemo (char *name)
 {
@@ -1533,6 +1546,8 @@ static void G_DoPlayDemo (void)
 	int32_t             i, episode, map;
 
 	gameaction = ga_nothing;
+	demostarttic = gametic;
+	demostarttime = I_GetTimeMicros ();
 	demobuffer = demo_p = W_CacheLumpName (defdemoname, PU_STATIC);
 	if (*demo_p++ != VERSION)
 		I_Error("Demo is from a different game version!");
@@ -1582,6 +1597,69 @@ void G_TimeDemo (char *name)
 }
 
 
+/*
+===================
+=
+= G_BatchDemo
+=
+= Times every demo lump or .lmp file after -batchdemo in turn
+=
+===================
+*/
+
+static int32_t		batchdemo;			// myargv index of the current demo, 0 if no batch
+static char			batchname[9];
+
+static void G_NextBatchDemo (void)
+{
+	char	*src, *slash;
+	int32_t	length;
+
+	src = myargv[batchdemo];
+	if ((slash = strrchr (src, '/')) != NULL || (slash = strrchr (src, '\\')) != NULL)
+		src = slash + 1;
+
+	// the lump name of a .lmp file is its base name
+	length = 0;
+	while (src[length] && src[length] != '.' && length < 8)
+	{
+		batchname[length] = src[length];
+		length++;
+	}
+	batchname[length] = 0;
+
+	defdemoname = batchname;
+	gameaction = ga_playdemo;
+}
+
+void G_BatchDemo (int32_t p)
+{
+	batchdemo = p + 1;
+	G_TimeDemo (NULL);
+	G_NextBatchDemo ();
+}
+
+static void G_BatchDemoDone (void)
+{
+	M_BenchResult (batchname, gametic - demostarttic, I_GetTimeMicros () - demostarttime, P_Checksum ());
+
+	Z_ChangeTag (demobuffer, PU_CACHE);
+	demoplayback = false;
+	netdemo = false;
+	netgame = false;
+	deathmatch = false;
+	playeringame[1] = playeringame[2] = playeringame[3] = 0;
+	respawnparm = false;
+	fastparm = false;
+	nomonsters = false;
+	consoleplayer = 0;
+
+	if (++batchdemo == myargc || myargv[batchdemo][0] == '-')
+		I_Exit ();
+	G_NextBatchDemo ();
+}
+
+
 /*
 ===================
 =
@@ -1593,11 +1671,20 @@ void G_TimeDemo (char *name)
 
 void G_CheckDemoStatus (void)
 {
+	if (batchdemo)
+	{
+		G_BatchDemoDone ();
+		return;
+	}
+
 	if (timingdemo)
 	{
 		int32_t realtics = I_GetTime() - starttime;
-		int32_t resultfps = TICRATE * 1000 * gametic / realtics;
-		I_Error ("Timed %i gametics in %i realtics. FPS: %u.%.3u", gametic, realtics, resultfps / 1000, resultfps % 1000);
+		int32_t resultfps;
+		if (!realtics)
+			realtics = 1;	// -nodraw can finish within a tic
+		resultfps = TICRATE * 1000 * gametic / realtics;
+		I_Error ("Timed %i gametics in %i realtics. FPS: %u.%.3u\n%s", gametic, realtics, resultfps / 1000, resultfps % 1000, M_BenchReport ());
 	}
 
 	if (demoplayback)
@@ -23,6 +23,7 @@
 #include <stdarg.h>
 #include "doomdef.h"
 #include "r_local.h"
+#include "a_tsmapi.h"
 
 #define DPMI_INT 0x31
 //#define NOTIMER
@@ -203,6 +204,8 @@ ticcmd_t *I_BaseTiccmd (void)
 = I_GetTime
 =
 = Returns time in 1/35th second tics.
+= I_GetTimeMicros returns it in microseconds, wrapping around after 71 minutes.
+= Outside benchmark runs it only advances with the timer interrupt.
 =
 ===================
 */
@@ -224,11 +227,25 @@ int32_t I_GetTime (void)
 
 	return (ticks * TICRATE) / CLOCKS_PER_SEC;
 }
+
+uint32_t I_GetTimeMicros (void)
+{
+	uint32_t ticks = clock();
+
+	ticks -= basetime;
+
+	return ((uint64_t)ticks * 1000000) / CLOCKS_PER_SEC;
+}
 #else
 int32_t I_GetTime (void)
 {
 	return ticcount;
 }
+
+uint32_t I_GetTimeMicros (void)
+{
+	return (TSM_GetTicks() * 1000000) / 1193182;
+}
 #endif
 
 /*
@@ -298,6 +315,79 @@ static byte *screen, *currentscreen;
 byte *destscreen;
 byte *destview	__attribute__ ((externally_visible));
 
+#if defined LINEAR_FRAMEBUFFER
+/*
+===================
+=
+= I_UpdateNoBlit
+=
+= Everything is drawn straight into screens[0]
+=
+===================
+*/
+
+void I_UpdateNoBlit(void)
+{
+	M_ClearBox (dirtybox);
+}
+
+/*
+===================
+=
+= I_FinishUpdate
+=
+===================
+*/
+
+void I_FinishUpdate (void)
+{
+	static	int32_t		lasttic;
+	int32_t				tics, i;
+
+	// draws little dots on the bottom of the screen
+	if (devparm)
+	{
+		tics = I_GetTime() - lasttic;
+		lasttic = I_GetTime();
+		if (tics > 20) tics = 20;
+
+		for (i=0 ; i<tics ; i++)
+			destscreen[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0xff;
+		for ( ; i<20 ; i++)
+			destscreen[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
+	}
+
+	// present
+	memcpy (screen, screens[0], SCREENWIDTH*SCREENHEIGHT);
+}
+
+/*
+===================
+=
+= I_InitGraphics
+=
+= Plain mode 13h, the frame is copied in one go
+=
+===================
+*/
+
+void I_InitGraphics (void)
+{
+	if (novideo)
+		return;
+	grmode = true;
+	regs.h.ah = 0;
+	regs.h.al = 0x13;
+	int386 (0x10, &regs, &regs);
+	screen = currentscreen = (byte *)(0xa0000 + __djgpp_conventional_base);
+	destscreen = screens[0];
+	memset (screen, 0, SCREENWIDTH*SCREENHEIGHT);
+	I_SetPalette (W_CacheLumpName("PLAYPAL", PU_CACHE));
+	I_InitDiskFlash ();
+}
+
+#else
+
 /*
 ===================
 =
@@ -464,6 +554,7 @@ void I_InitGraphics (void)
 	I_SetPalette (W_CacheLumpName("PLAYPAL", PU_CACHE));
 	I_InitDiskFlash ();
 }
+#endif
 
 /*
 ===================
@@ -493,6 +584,12 @@ static void I_ShutdownGraphics (void)
 ===================
 */
 
+#if defined LINEAR_FRAMEBUFFER
+void I_ReadScreen (byte *scr)
+{
+	memcpy (scr, screens[0], SCREENWIDTH*SCREENHEIGHT);
+}
+#else
 void I_ReadScreen (byte *scr)
 {
 	int32_t	p, i;
@@ -504,6 +601,7 @@ void I_ReadScreen (byte *scr)
 			scr[i*4+p] = currentscreen[i];
 	}
 }
+#endif
 
 
 //===========================================================================
@@ -1161,6 +1259,7 @@ void I_Error (char *error, ...)
 	vprintf (error,argptr);
 	va_end (argptr);
 	printf ("\n");
+	M_BenchDump ();
 	exit (1);
 }
 
@@ -1193,6 +1292,26 @@ void I_Quit (void)
 	regs.h.dh = 23;
 	int386 (0x10, &regs, &regs); // Set text pos
 	printf ("\n");
+	M_BenchDump ();
+	exit (0);
+}
+
+/*
+===============
+=
+= I_Exit
+=
+= Like I_Quit, but a benchmark run leaves the defaults alone
+= and doesn't show ENDOOM
+=
+===============
+*/
+
+void I_Exit (void)
+{
+	D_QuitNetGame ();
+	I_Shutdown ();
+	M_BenchDump ();
 	exit (0);
 }
 
@@ -1301,6 +1420,59 @@ byte *I_ZoneBase (int32_t *size)
 =============================================================================
 */
 
+#if defined LINEAR_FRAMEBUFFER
+static byte diskicon[16*16], diskbackup[16*16];
+
+static void I_CopyDiskRect (byte *dest, int32_t destwidth, byte *src, int32_t srcwidth)
+{
+	int32_t	y;
+
+	for (y=0 ; y<16 ; y++)
+	{
+		memcpy (dest, src, 16);
+		src += srcwidth;
+		dest += destwidth;
+	}
+}
+
+static void I_InitDiskFlash (void)
+{
+	void    *pic;
+	byte    *corner;
+
+	if (M_CheckParm ("-cdrom"))
+		pic = W_CacheLumpName ("STCDROM",PU_CACHE);
+	else
+		pic = W_CacheLumpName ("STDISK",PU_CACHE);
+
+	// render the icon through screens[0] and put back what was there
+	corner = screens[0] + 184*SCREENWIDTH + 304;
+	I_CopyDiskRect (diskbackup, 16, corner, SCREENWIDTH);
+	V_DrawPatchDirect (SCREENWIDTH-16,SCREENHEIGHT-16,pic);
+	I_CopyDiskRect (diskicon, 16, corner, SCREENWIDTH);
+	I_CopyDiskRect (corner, SCREENWIDTH, diskbackup, 16);
+}
+
+// draw disk icon
+void I_BeginRead (void)
+{
+	if (!grmode)
+		return;
+
+	I_CopyDiskRect (diskbackup, 16, screen + 184*SCREENWIDTH + 304, SCREENWIDTH);
+	I_CopyDiskRect (screen + 184*SCREENWIDTH + 304, SCREENWIDTH, diskicon, 16);
+}
+
+// erase disk icon
+void I_EndRead (void)
+{
+	if (!grmode)
+		return;
+
+	I_CopyDiskRect (screen + 184*SCREENWIDTH + 304, SCREENWIDTH, diskbackup, 16);
+}
+
+#else
 static void I_InitDiskFlash (void)
 {
 	void    *pic;
@@ -1398,6 +1570,7 @@ void I_EndRead (void)
 	outp (GC_INDEX,GC_MODE);
 	outp (GC_INDEX+1,inp(GC_INDEX+1)&~1);
 }
+#endif
 
 
 
@@ -0,0 +1,879 @@
+//
+// Copyright (C) 1993-1996 Id Software, Inc.
+// Copyright (C) 2023-2024 Frenkel Smeijers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// I_POSIX.C
+
+// Headless replacement for I_IBM.C and I_SOUND.C.
+// There is no video card, no keyboard, no mouse and no sound card,
+// so -timedemo runs as fast as the machine allows.
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "doomdef.h"
+#include "r_local.h"
+
+/*
+=============================================================================
+
+							CONSTANTS
+
+=============================================================================
+*/
+
+#define VIDEOMEMORYSIZE	0x10000	// 0xa0000 - 0xaffff
+
+#define ZONESIZE		0x800000
+
+static boolean grmode;
+
+//==================================================
+
+#define KEY_LSHIFT      0xfe
+
+#define KEY_INS         (0x80+0x52)
+#define KEY_DEL         (0x80+0x53)
+#define KEY_PGUP        (0x80+0x49)
+#define KEY_PGDN        (0x80+0x51)
+#define KEY_HOME        (0x80+0x47)
+#define KEY_END         (0x80+0x4f)
+
+// used by M_LoadDefaults to translate the key bindings
+byte        scantokey[128] =
+					{
+//  0           1       2       3       4       5       6       7
+//  8           9       A       B       C       D       E       F
+	0  ,    27,     '1',    '2',    '3',    '4',    '5',    '6',
+	'7',    '8',    '9',    '0',    '-',    '=',    KEY_BACKSPACE, 9, // 0
+	'q',    'w',    'e',    'r',    't',    'y',    'u',    'i',
+	'o',    'p',    '[',    ']',    13 ,    KEY_RCTRL,'a',  's',      // 1
+	'd',    'f',    'g',    'h',    'j',    'k',    'l',    ';',
+	39 ,    '`',    KEY_LSHIFT,92,  'z',    'x',    'c',    'v',      // 2
+	'b',    'n',    'm',    ',',    '.',    '/',    KEY_RSHIFT,'*',
+	KEY_RALT,' ',   0  ,    KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5,   // 3
+	KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10,0  ,    0  , KEY_HOME,
+	KEY_UPARROW,KEY_PGUP,'-',KEY_LEFTARROW,'5',KEY_RIGHTARROW,'+',KEY_END, //4
+	KEY_DOWNARROW,KEY_PGDN,KEY_INS,KEY_DEL,0,0,             0,              KEY_F11,
+	KEY_F12,0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0,        // 5
+	0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0,
+	0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0,        // 6
+	0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0,
+	0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0  ,    0         // 7
+					};
+
+//==========================================================================
+
+/*
+===================
+=
+= I_BaseTiccmd
+=
+===================
+*/
+
+static ticcmd_t emptycmd;
+
+ticcmd_t *I_BaseTiccmd (void)
+{
+	return &emptycmd;
+}
+
+/*
+===================
+=
+= I_GetTime
+=
+= Returns time in 1/35th second tics.
+= I_GetTimeMicros returns it in microseconds, wrapping around after 71 minutes.
+=
+===================
+*/
+
+static struct timespec basetime;
+
+static void I_InitBaseTime (void)
+{
+	clock_gettime (CLOCK_MONOTONIC, &basetime);
+}
+
+int32_t I_GetTime (void)
+{
+	struct timespec	now;
+	int64_t			ns;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	ns = (int64_t)(now.tv_sec - basetime.tv_sec) * 1000000000
+		+ (now.tv_nsec - basetime.tv_nsec);
+
+	return (ns * TICRATE) / 1000000000;
+}
+
+uint32_t I_GetTimeMicros (void)
+{
+	struct timespec	now;
+	int64_t			ns;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	ns = (int64_t)(now.tv_sec - basetime.tv_sec) * 1000000000
+		+ (now.tv_nsec - basetime.tv_nsec);
+
+	return ns / 1000;
+}
+
+/*
+===================
+=
+= I_WaitVBL
+=
+= There is no vertical retrace to wait for.
+=
+===================
+*/
+
+void I_WaitVBL (int32_t vbls)
+{
+	UNUSED(vbls);
+}
+
+/*
+===================
+=
+= I_SetPalette
+=
+= Palette source must use 8 bit RGB elements.
+=
+===================
+*/
+
+static byte palette6[768];	// what the VGA DAC would have been given
+
+void I_SetPalette (byte *palette)
+{
+	int32_t	i;
+
+	for (i = 0; i < 768; i++)
+		palette6[i] = (gammatable[usegamma][*palette++])>>2;
+}
+
+/*
+============================================================================
+
+							GRAPHICS MODE
+
+============================================================================
+*/
+
+// Stands in for the 64 kB VGA window, so the renderer and the
+// V_, R_ and I_ routines keep their page flipping and offsets.
+uint8_t *I_VideoMemory;
+
+byte *destscreen;
+byte *destview	__attribute__ ((externally_visible));
+
+#if defined LINEAR_FRAMEBUFFER
+#if defined RENDER_RESOLUTION
+static byte *scaledframe;		// what a display at the render resolution would show, with -upscale
+#endif
+
+/*
+===================
+=
+= I_UpdateNoBlit
+=
+= Everything is drawn straight into screens[0]
+=
+===================
+*/
+
+void I_UpdateNoBlit(void)
+{
+	M_ClearBox (dirtybox);
+}
+
+/*
+===================
+=
+= I_FinishUpdate
+=
+===================
+*/
+
+void I_FinishUpdate (void)
+{
+	static	int32_t		lasttic;
+	int32_t				tics, i;
+
+	// draws little dots on the bottom of the screen
+	if (devparm)
+	{
+		tics = I_GetTime() - lasttic;
+		lasttic = I_GetTime();
+		if (tics > 20) tics = 20;
+
+		for (i=0 ; i<tics ; i++)
+			destscreen[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0xff;
+		for ( ; i<20 ; i++)
+			destscreen[ (SCREENHEIGHT-1)*SCREENWIDTH + i] = 0x0;
+		V_MarkRect (0, SCREENHEIGHT-1, 20, 1);
+	}
+
+	// present
+	memcpy (I_VideoMemory, screens[0], SCREENWIDTH*SCREENHEIGHT);
+
+#if defined RENDER_RESOLUTION
+	// and at the render resolution
+	if (scaledframe)
+		R_DrawScaledFrame (scaledframe);
+#endif
+}
+
+/*
+===================
+=
+= I_InitGraphics
+=
+===================
+*/
+
+void I_InitGraphics (void)
+{
+	grmode = true;
+	destscreen = screens[0];
+	memset (I_VideoMemory, 0, VIDEOMEMORYSIZE);
+	I_SetPalette (W_CacheLumpName("PLAYPAL", PU_CACHE));
+
+#if defined RENDER_RESOLUTION
+	// -upscale times the scaling up of every frame as part of the present
+	if (renderscreen && M_CheckParm ("-upscale"))
+	{
+		scaledframe = malloc (RENDERWIDTH*RENDERHEIGHT);
+		if (!scaledframe)
+			I_Error ("I_InitGraphics: couldn't allocate the scaled frame");
+	}
+#endif
+}
+
+/*
+===================
+=
+= I_ReadScreen
+=
+= Reads the screen currently displayed into a linear buffer.
+=
+===================
+*/
+
+void I_ReadScreen (byte *scr)
+{
+	memcpy (scr, screens[0], SCREENWIDTH*SCREENHEIGHT);
+}
+
+#else
+static byte *screen, *currentscreen;
+
+/*
+===================
+=
+= I_UpdateBox
+=
+===================
+*/
+
+static void I_UpdateBox (int32_t x, int32_t y, int32_t width, int32_t height)
+{
+	int32_t		ofs;
+	byte	*source;
+	int16_t	*dest;
+	int32_t		p,x1, x2;
+	int32_t		srcdelta, destdelta;
+	int32_t		wwide;
+
+#ifdef RANGECHECK
+	if (x < 0 || y < 0 || width <= 0 || height <= 0
+		|| x + width > SCREENWIDTH || y + height > SCREENHEIGHT)
+	{
+		I_Error("Bad I_UpdateBox (%i, %i, %i, %i)", x, y, width, height);
+	}
+#endif
+
+	x1 = x>>3;
+	x2 = (x+width)>>3;
+	wwide = x2-x1+1;
+
+	ofs = y*SCREENWIDTH+(x1<<3);
+	srcdelta = SCREENWIDTH - (wwide<<3);
+	destdelta = PLANEWIDTH/2 - wwide;
+
+	for (p = 0 ; p < 4 ; p++)
+	{
+		source = screens[0] + ofs + p;
+		dest = (int16_t *)(destscreen + (ofs>>2));
+		for (y=0 ; y<height ; y++)
+		{
+			for (x=wwide ; x ; x--)
+			{
+				*dest++ = *source + (source[4]<<8);
+				source += 8;
+			}
+			source+=srcdelta;
+			dest+=destdelta;
+		}
+	}
+}
+
+/*
+===================
+=
+= I_UpdateNoBlit
+=
+===================
+*/
+
+void I_UpdateNoBlit(void)
+{
+	static int32_t oldupdatebox[4];
+	static int32_t voldupdatebox[4];
+	int32_t updatebox[4];
+
+	currentscreen = destscreen;
+	updatebox[BOXTOP] = (dirtybox[BOXTOP] > voldupdatebox[BOXTOP]) ?
+		dirtybox[BOXTOP] : voldupdatebox[BOXTOP];
+	updatebox[BOXRIGHT] = (dirtybox[BOXRIGHT] > voldupdatebox[BOXRIGHT]) ?
+		dirtybox[BOXRIGHT] : voldupdatebox[BOXRIGHT];
+	updatebox[BOXBOTTOM] = (dirtybox[BOXBOTTOM] < voldupdatebox[BOXBOTTOM]) ?
+		dirtybox[BOXBOTTOM] : voldupdatebox[BOXBOTTOM];
+	updatebox[BOXLEFT] = (dirtybox[BOXLEFT] < voldupdatebox[BOXLEFT]) ?
+		dirtybox[BOXLEFT] : voldupdatebox[BOXLEFT];
+
+	updatebox[BOXTOP] = (updatebox[BOXTOP] > oldupdatebox[BOXTOP]) ?
+		updatebox[BOXTOP] : oldupdatebox[BOXTOP];
+	updatebox[BOXRIGHT] = (updatebox[BOXRIGHT] > oldupdatebox[BOXRIGHT]) ?
+		updatebox[BOXRIGHT] : oldupdatebox[BOXRIGHT];
+	updatebox[BOXBOTTOM] = (updatebox[BOXBOTTOM] < oldupdatebox[BOXBOTTOM]) ?
+		updatebox[BOXBOTTOM] : oldupdatebox[BOXBOTTOM];
+	updatebox[BOXLEFT] = (updatebox[BOXLEFT] < oldupdatebox[BOXLEFT]) ?
+		updatebox[BOXLEFT] : oldupdatebox[BOXLEFT];
+
+	memcpy (voldupdatebox, oldupdatebox, sizeof(oldupdatebox));
+	memcpy (oldupdatebox, dirtybox, sizeof(dirtybox));
+
+	if (updatebox[BOXTOP] >= updatebox[BOXBOTTOM])
+		I_UpdateBox (updatebox[BOXLEFT], updatebox[BOXBOTTOM],
+			updatebox[BOXRIGHT] - updatebox[BOXLEFT] + 1,
+			updatebox[BOXTOP] - updatebox[BOXBOTTOM] + 1);
+
+	M_ClearBox (dirtybox);
+}
+
+/*
+===================
+=
+= I_FinishUpdate
+=
+===================
+*/
+
+void I_FinishUpdate (void)
+{
+	static	int32_t		lasttic;
+	int32_t				tics, i;
+
+	// draws little dots on the bottom of the screen
+	if (devparm)
+	{
+		tics = I_GetTime() - lasttic;
+		lasttic = I_GetTime();
+		if (tics > 20) tics = 20;
+
+		for (i=0 ; i<tics ; i++)
+			destscreen[ (SCREENHEIGHT-1)*PLANEWIDTH + i] = 0xff;
+		for ( ; i<20 ; i++)
+			destscreen[ (SCREENHEIGHT-1)*PLANEWIDTH + i] = 0x0;
+	}
+
+	// page flip
+	destscreen += 0x4000;
+	if (destscreen == I_VideoMemory + 0xc000)
+		destscreen = I_VideoMemory;
+}
+
+/*
+===================
+=
+= I_InitGraphics
+=
+===================
+*/
+
+void I_InitGraphics (void)
+{
+	grmode = true;
+	screen = currentscreen = I_VideoMemory;
+	destscreen = I_VideoMemory + 0x4000;
+	memset (screen, 0, VIDEOMEMORYSIZE);
+	I_SetPalette (W_CacheLumpName("PLAYPAL", PU_CACHE));
+}
+
+/*
+===================
+=
+= I_ReadScreen
+=
+= Reads the screen currently displayed into a linear buffer.
+=
+===================
+*/
+
+void I_ReadScreen (byte *scr)
+{
+	int32_t	p, i;
+
+	for (p = 0; p < 4; p++)
+	{
+		for (i = 0; i < SCREENWIDTH*SCREENHEIGHT/4; i++)
+			scr[i*4+p] = currentscreen[i];
+	}
+}
+#endif
+
+
+//===========================================================================
+
+/*
+===================
+=
+= I_StartTic
+=
+= There is no input, so there are no events to post.
+=
+===================
+*/
+
+void I_StartTic (void)
+{
+}
+
+/*
+===============
+=
+= I_StartFrame
+=
+===============
+*/
+
+void I_StartFrame (void)
+{
+}
+
+
+/*
+============================================================================
+
+							SOUND
+
+============================================================================
+*/
+
+// config file variables, so default.cfg keeps its layout
+int32_t snd_DesiredMusicDevice, snd_DesiredSfxDevice;
+int32_t snd_SBport, snd_SBirq, snd_SBdma;
+int32_t snd_Mport;
+
+void I_StartupSound (void)
+{
+	printf("  no sound\n");
+}
+
+void I_ShutdownSound (void)
+{
+}
+
+void I_SetChannels(int32_t channels)
+{
+	UNUSED(channels);
+}
+
+boolean I_IsAdlib(void)
+{
+	return false;
+}
+
+void I_PauseSong(int32_t handle)
+{
+	UNUSED(handle);
+}
+
+void I_ResumeSong(int32_t handle)
+{
+	UNUSED(handle);
+}
+
+void I_SetMusicVolume(int32_t volume)
+{
+	UNUSED(volume);
+}
+
+int32_t I_RegisterSong(void *data)
+{
+	UNUSED(data);
+	return 0;
+}
+
+void I_UnRegisterSong(int32_t handle)
+{
+	UNUSED(handle);
+}
+
+void I_StopSong(int32_t handle)
+{
+	UNUSED(handle);
+}
+
+void I_PlaySong(int32_t handle, boolean looping)
+{
+	UNUSED(handle);
+	UNUSED(looping);
+}
+
+int32_t I_GetSfxLumpNum(sfxinfo_t *sound)
+{
+	char namebuf[9];
+
+	if (sound->link) sound = sound->link;
+	sprintf(namebuf, "dp%s", sound->name);	// same lumps as DOS with -nosound
+	return W_GetNumForName(namebuf);
+}
+
+int32_t I_StartSound (void *data, int32_t vol, int32_t sep, int32_t pitch)
+{
+	UNUSED(data);
+	UNUSED(vol);
+	UNUSED(sep);
+	UNUSED(pitch);
+	return -1;
+}
+
+void I_StopSound(int32_t handle)
+{
+	UNUSED(handle);
+}
+
+boolean I_SoundIsPlaying(int32_t handle)
+{
+	UNUSED(handle);
+	return false;
+}
+
+void I_UpdateSoundParams(int32_t handle, int32_t vol, int32_t sep, int32_t pitch)
+{
+	UNUSED(handle);
+	UNUSED(vol);
+	UNUSED(sep);
+	UNUSED(pitch);
+}
+
+
+//===========================================================================
+
+
+/*
+===============
+=
+= I_Init
+=
+===============
+*/
+
+void I_Init (void)
+{
+	I_VideoMemory = malloc (VIDEOMEMORYSIZE);
+	if (!I_VideoMemory)
+		I_Error ("I_Init: malloc() of video memory failed");
+	memset (I_VideoMemory, 0, VIDEOMEMORYSIZE);
+
+	printf ("I_InitBaseTime\n");
+	I_InitBaseTime ();
+	printf ("I_StartupSound\n");
+	I_StartupSound ();
+}
+
+
+/*
+===============
+=
+= I_Shutdown
+=
+= return to default system state
+=
+===============
+*/
+
+static void I_Shutdown (void)
+{
+	I_ShutdownSound ();
+}
+
+
+/*
+================
+=
+= I_Error
+=
+================
+*/
+
+void I_Error (char *error, ...)
+{
+	va_list argptr;
+
+	D_QuitNetGame ();
+	I_Shutdown ();
+	va_start (argptr,error);
+	vprintf (error,argptr);
+	va_end (argptr);
+	printf ("\n");
+	M_BenchDump ();
+	exit (1);
+}
+
+/*
+===============
+=
+= I_Quit
+=
+= Shuts down net game, saves defaults and exits.
+=
+===============
+*/
+
+void I_Quit (void)
+{
+	if (demorecording)
+		G_CheckDemoStatus ();
+	else
+		D_QuitNetGame ();
+	M_SaveDefaults ();
+	I_Shutdown ();
+	M_BenchDump ();
+	exit (0);
+}
+
+/*
+===============
+=
+= I_Exit
+=
+= Like I_Quit, but a benchmark run leaves the defaults alone
+=
+===============
+*/
+
+void I_Exit (void)
+{
+	D_QuitNetGame ();
+	I_Shutdown ();
+	M_BenchDump ();
+	exit (0);
+}
+
+/*
+===============
+=
+= I_ZoneBase
+=
+= The zone is mapped in one piece, the same size DOS gets at most,
+= so the cache behaves the same on both platforms.
+=
+===============
+*/
+
+byte *I_ZoneBase (int32_t *size)
+{
+	byte	*ptr;
+
+	ptr = mmap (NULL, ZONESIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ptr == MAP_FAILED)
+		I_Error ("I_ZoneBase: mmap() of %d kB failed", ZONESIZE >> 10);
+
+	printf ("%d kB allocated for zone\n", ZONESIZE >> 10);
+
+	*size = ZONESIZE;
+	return ptr;
+}
+
+/*
+=============================================================================
+
+					WORKER THREADS
+
+=============================================================================
+*/
+
+#define MAXWORKERS	16
+
+static pthread_mutex_t	workermutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	workerstart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	workerdone = PTHREAD_COND_INITIALIZER;
+static void				(*workerfunc) (int32_t worker);
+static int32_t			numworkers;
+static int32_t			workerjob;		// counts the I_RunWorkers calls
+static int32_t			workersbusy;
+
+static void *I_WorkerThread (void *arg)
+{
+	int32_t		worker = (intptr_t)arg;
+	int32_t		job = 0;
+
+	for (;;)
+	{
+		pthread_mutex_lock (&workermutex);
+		while (workerjob == job)
+			pthread_cond_wait (&workerstart, &workermutex);
+		job = workerjob;
+		pthread_mutex_unlock (&workermutex);
+
+		workerfunc (worker);
+
+		pthread_mutex_lock (&workermutex);
+		if (--workersbusy == 0)
+			pthread_cond_signal (&workerdone);
+		pthread_mutex_unlock (&workermutex);
+	}
+
+	return NULL;
+}
+
+int32_t I_StartWorkers (int32_t count)
+{
+	pthread_t	thread;
+
+	if (count > MAXWORKERS)
+		count = MAXWORKERS;
+
+	for (numworkers = 0; numworkers < count; numworkers++)
+		if (pthread_create (&thread, NULL, I_WorkerThread, (void *)(intptr_t)numworkers))
+			break;
+	if (!numworkers)
+		I_Error ("I_StartWorkers: couldn't start a thread");
+
+	printf ("I_StartWorkers: %i threads\n", numworkers);
+	return numworkers;
+}
+
+void I_RunWorkers (void (*func) (int32_t worker))
+{
+	pthread_mutex_lock (&workermutex);
+	workerfunc = func;
+	workersbusy = numworkers;
+	workerjob++;
+	pthread_cond_broadcast (&workerstart);
+	while (workersbusy)
+		pthread_cond_wait (&workerdone, &workermutex);
+	pthread_mutex_unlock (&workermutex);
+}
+
+/*
+=============================================================================
+
+					DISK ICON FLASHING
+
+=============================================================================
+*/
+
+void I_BeginRead (void)
+{
+}
+
+void I_EndRead (void)
+{
+}
+
+
+
+/*
+============================================================================
+
+						NETWORKING
+
+============================================================================
+*/
+
+/*
+====================
+=
+= I_InitNetwork
+=
+====================
+*/
+
+void I_InitNetwork (void)
+{
+	if (M_CheckParm ("-net"))
+		I_Error ("I_InitNetwork: no network driver on this platform");
+
+	//
+	// single player game
+	//
+	doomcom = malloc (sizeof (*doomcom) );
+	if (!doomcom)
+		I_Error("malloc() in I_InitNetwork() failed");
+	memset (doomcom, 0, sizeof(*doomcom) );
+	netgame = false;
+	doomcom->id = DOOMCOM_ID;
+	doomcom->numplayers = doomcom->numnodes = 1;
+	doomcom->deathmatch = false;
+	doomcom->consoleplayer = 0;
+	doomcom->ticdup = 1;
+	doomcom->extratics = 0;
+}
+
+void I_NetCmd (void)
+{
+	I_Error ("I_NetCmd when not in netgame");
+}
+
+
+/*
+============================================================================
+
+						DOS LIBRARY
+
+============================================================================
+*/
+
+char *strupr (char *s)
+{
+	char	*p;
+
+	for (p = s; *p; p++)
+		*p = toupper (*p);
+	return s;
+}
+
+int32_t filelength (int32_t handle)
+{
+	struct stat	fileinfo;
+
+	if (fstat (handle, &fileinfo) == -1)
+		I_Error ("Error fstating");
+	return fileinfo.st_size;
+}
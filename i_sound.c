@@ -46,6 +46,11 @@ static void I_StartupTimer (void)
 #if defined NOTIMER
 	I_InitBaseTime();
 #else
+	// benchmark runs read the timer's counter for I_GetTimeMicros,
+	// other runs leave the timer in the mode the BIOS sets
+	if (M_CheckParm ("-timedemo") || M_CheckParm ("-batchdemo") || M_CheckParm ("-profile"))
+		TSM_EnableTickCounter();
+
 	// installs master timer.  Must be done before StartupTimer()!
 	TSM_Install(SND_TICRATE);
 	tsm_ID = TSM_NewService (I_TimerISR, TICRATE, 0, 0); // max priority
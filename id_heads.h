@@ -21,6 +21,7 @@
 #ifndef __ID_HEADS__
 #define __ID_HEADS__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -0,0 +1,449 @@
+//
+// Copyright (C) 2024 Frenkel Smeijers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// M_bench.c
+
+// Frame timing for -timedemo.
+// Every D_Display call is timestamped, the report at the end of the demo
+// has percentiles and the slowest frames, because an average FPS hides
+// the stutter.
+//
+// -csv <file>   writes the time of every frame
+// -json <file>  writes the summary
+//
+// -batchdemo plays a list of demos, the result of every demo
+// is printed on exit, including a hash of the final world state.
+//
+// -profile times the subsystems of every frame, shows the previous frame
+// on top of the view and prints the averages on exit.
+// With the render threads, bsp, planes and masked only record the columns
+// and spans, records is the time the threads take to draw them.
+//
+// -lumpstats shows the lump cache hits and misses of every category
+// on top of the view and prints them on exit.
+//
+// -profile also prints the peak use of the drawseg, vissprite, opening
+// and intercept pools.
+
+#include <ctype.h>
+#include "doomdef.h"
+#include "hu_stuff.h"
+
+#define SLOWESTFRAMES	5
+
+extern patch_t *hu_font[HU_FONTSIZE];
+
+typedef struct
+{
+	uint32_t	time;		// microseconds since the previous frame
+	int32_t		gametic;
+} frametime_t;
+
+static frametime_t	*frametimes;
+static int32_t		numframes, maxframes;
+static uint32_t		lastframe;
+static boolean		benchactive;
+
+static char			*results;
+static int32_t		resultslength;
+
+boolean				profiling;
+boolean				showlumpstats;
+
+static uint32_t		profstart[NUMPROFILES];
+static uint32_t		profframe[NUMPROFILES];		// accumulated during this frame
+static uint32_t		proflast[NUMPROFILES];		// the previous frame, for the overlay
+static uint32_t		profmax[NUMPROFILES];
+static uint64_t		proftotal[NUMPROFILES];
+static int32_t		profframes;
+static uint32_t		profframestart;
+
+static const char	*const profnames[NUMPROFILES] =
+{
+	"frame", "bsp", "planes", "masked", "records", "scale", "playsim", "thinkers", "sound", "hud", "present"
+};
+
+static int32_t		poolpeak[NUMPOOLS];
+static int32_t		pooloverflows[NUMPOOLS];
+
+static const char	*const poolnames[NUMPOOLS] =
+{
+	"drawsegs", "vissprites", "openings", "intercepts"
+};
+
+/*
+===================
+=
+= M_BenchStart
+=
+= Called when a level of the timed demo has been loaded,
+= so the load time doesn't count as a frame
+=
+===================
+*/
+
+void M_BenchStart (void)
+{
+	benchactive = true;
+	lastframe = I_GetTimeMicros ();
+}
+
+/*
+===================
+=
+= M_BenchFrame
+=
+===================
+*/
+
+static void M_ProfileFrame (void)
+{
+	uint32_t	now;
+	int32_t		p;
+
+	now = I_GetTimeMicros ();
+	if (profframes)
+		profframe[prof_frame] = now - profframestart;
+	profframestart = now;
+
+	// the time before the first frame isn't a frame, M_BenchDump
+	// divides by profframes - 1
+	for (p = 0; p < NUMPROFILES; p++)
+	{
+		if (profframes)
+		{
+			proflast[p] = profframe[p];
+			proftotal[p] += profframe[p];
+			if (profmax[p] < profframe[p])
+				profmax[p] = profframe[p];
+		}
+		profframe[p] = 0;
+	}
+	profframes++;
+}
+
+void M_BenchFrame (void)
+{
+	uint32_t	now;
+
+	if (profiling)
+		M_ProfileFrame ();
+
+	if (!benchactive)
+		return;
+
+	now = I_GetTimeMicros ();
+
+	if (numframes == maxframes)
+	{
+		maxframes = maxframes ? maxframes * 2 : 4096;
+		frametimes = realloc (frametimes, maxframes * sizeof(*frametimes));
+		if (!frametimes)
+			I_Error ("M_BenchFrame: couldn't allocate %i frames", maxframes);
+	}
+
+	frametimes[numframes].time = now - lastframe;
+	frametimes[numframes].gametic = gametic;
+	numframes++;
+
+	lastframe = now;
+}
+
+/*
+===================
+=
+= M_BenchReport
+=
+= Returns the summary for the exit message
+=
+===================
+*/
+
+static int M_CompareTimes (const void *a, const void *b)
+{
+	uint32_t ta = *(const uint32_t *)a;
+	uint32_t tb = *(const uint32_t *)b;
+
+	return ta < tb ? -1 : ta > tb;
+}
+
+// nearest rank
+static uint32_t M_Percentile (uint32_t *sorted, int32_t pct)
+{
+	int32_t rank = (numframes * pct + 99) / 100;
+
+	return sorted[rank ? rank - 1 : 0];
+}
+
+#define MS(t)	(t) / 1000, (t) % 1000
+
+char *M_BenchReport (void)
+{
+	static char	report[512];
+	uint32_t	*sorted;
+	uint64_t	total;
+	uint32_t	average, p50, p95, p99;
+	int32_t		slowest[SLOWESTFRAMES];
+	int32_t		numslowest;
+	int32_t		i, j;
+	char		*s;
+	FILE		*fp;
+
+	benchactive = false;
+	if (!numframes)
+		return "";
+
+	sorted = malloc (numframes * sizeof(*sorted));
+	if (!sorted)
+		return "";
+
+	total = 0;
+	for (i = 0; i < numframes; i++)
+	{
+		sorted[i] = frametimes[i].time;
+		total += sorted[i];
+	}
+	qsort (sorted, numframes, sizeof(*sorted), M_CompareTimes);
+
+	average = total / numframes;
+	p50 = M_Percentile (sorted, 50);
+	p95 = M_Percentile (sorted, 95);
+	p99 = M_Percentile (sorted, 99);
+
+	// find the slowest frames, the slowest first
+	numslowest = numframes < SLOWESTFRAMES ? numframes : SLOWESTFRAMES;
+	for (i = 0; i < numslowest; i++)
+	{
+		slowest[i] = -1;
+		for (j = 0; j < numframes; j++)
+		{
+			int32_t k;
+
+			if (slowest[i] != -1 && frametimes[j].time <= frametimes[slowest[i]].time)
+				continue;
+			for (k = 0; k < i; k++)
+				if (slowest[k] == j)
+					break;
+			if (k == i)
+				slowest[i] = j;
+		}
+	}
+
+	s = report;
+	s += sprintf (s, "%i frames, ms: min %u.%.3u avg %u.%.3u max %u.%.3u p50 %u.%.3u p95 %u.%.3u p99 %u.%.3u\nSlowest:",
+		numframes, MS(sorted[0]), MS(average), MS(sorted[numframes - 1]), MS(p50), MS(p95), MS(p99));
+	for (i = 0; i < numslowest; i++)
+		s += sprintf (s, " %u.%.3u (tic %i)", MS(frametimes[slowest[i]].time), frametimes[slowest[i]].gametic);
+	sprintf (s, "\n");
+
+	i = M_CheckParm ("-csv");
+	if (i && i < myargc - 1 && (fp = fopen (myargv[i + 1], "w")) != NULL)
+	{
+		fprintf (fp, "frame,gametic,us\n");
+		for (j = 0; j < numframes; j++)
+			fprintf (fp, "%i,%i,%u\n", j, frametimes[j].gametic, frametimes[j].time);
+		fclose (fp);
+	}
+
+	i = M_CheckParm ("-json");
+	if (i && i < myargc - 1 && (fp = fopen (myargv[i + 1], "w")) != NULL)
+	{
+		fprintf (fp, "{\n");
+		fprintf (fp, "\t\"gametics\": %i,\n", gametic);
+		fprintf (fp, "\t\"frames\": %i,\n", numframes);
+		fprintf (fp, "\t\"us\": {\"min\": %u, \"avg\": %u, \"max\": %u, \"p50\": %u, \"p95\": %u, \"p99\": %u},\n",
+			sorted[0], average, sorted[numframes - 1], p50, p95, p99);
+		fprintf (fp, "\t\"slowest\": [");
+		for (i = 0; i < numslowest; i++)
+			fprintf (fp, "%s{\"gametic\": %i, \"us\": %u}", i ? ", " : "",
+				frametimes[slowest[i]].gametic, frametimes[slowest[i]].time);
+		fprintf (fp, "]\n}\n");
+		fclose (fp);
+	}
+
+	free (sorted);
+	numframes = 0;
+	return report;
+}
+
+/*
+===================
+=
+= M_BenchResult
+=
+= Logs a demo of -batchdemo, the video mode is still set so the
+= results are kept until M_BenchDump
+=
+===================
+*/
+
+void M_BenchResult (char *name, int32_t gametics, uint32_t time, uint32_t checksum)
+{
+	char		line[80];
+	char		*report;
+	int32_t		length;
+
+	report = M_BenchReport ();
+	length = sprintf (line, "%-8s %6i gametics %5u.%.3u s hash %08x\n",
+		name, gametics, time / 1000000, time / 1000 % 1000, checksum);
+
+	results = realloc (results, resultslength + length + strlen (report) + 1);
+	if (!results)
+		I_Error ("M_BenchResult: couldn't allocate the results");
+	strcpy (results + resultslength, line);
+	strcpy (results + resultslength + length, report);
+	resultslength += length + strlen (report);
+}
+
+/*
+===================
+=
+= M_ProfileStart / M_ProfileStop
+=
+= Scoped timers, a subsystem can be timed several times per frame
+=
+===================
+*/
+
+void M_ProfileStart (profile_t p)
+{
+	if (profiling)
+		profstart[p] = I_GetTimeMicros ();
+}
+
+void M_ProfileStop (profile_t p)
+{
+	if (profiling)
+		profframe[p] += I_GetTimeMicros () - profstart[p];
+}
+
+/*
+===================
+=
+= M_ProfileDrawer
+=
+= Draws the times of the previous frame and the lump cache statistics
+= in the top left corner of the view
+=
+===================
+*/
+
+static void M_ProfileWriteText (int32_t x, int32_t y, char *string)
+{
+	int32_t		c, w;
+
+	while ((c = *string++) != 0)
+	{
+		c = toupper(c) - HU_FONTSTART;
+		if (c < 0 || c >= HU_FONTSIZE)
+		{
+			x += 4;
+			continue;
+		}
+
+		w = SHORT (hu_font[c]->width);
+		if (x + w > viewwindowx + scaledviewwidth)
+			break;
+		V_DrawPatchDirect (x, y, hu_font[c]);
+		x += w;
+	}
+}
+
+void M_ProfileDrawer (void)
+{
+	char		line[48];
+	int32_t		p, y;
+	lumpstats_t	*c;
+
+	// below the message line
+	y = viewwindowy + 10;
+	for (p = 0; profiling && p < NUMPROFILES; p++)
+	{
+		if (y + 8 > viewwindowy + scaledviewheight)
+			return;
+		sprintf (line, "%s %u.%.2u", profnames[p], proflast[p] / 1000, proflast[p] % 1000 / 10);
+		M_ProfileWriteText (viewwindowx + 2, y, line);
+		y += 8;
+	}
+
+	// hits, misses, rereads and kB read
+	for (p = 0; showlumpstats && p < NUMLUMPCATEGORIES; p++)
+	{
+		if (y + 8 > viewwindowy + scaledviewheight)
+			return;
+		c = &lumpcategorystats[p];
+		sprintf (line, "%s %i %i %i %uk", lumpcategorynames[p], c->hits, c->misses, c->rereads, c->bytes / 1024);
+		M_ProfileWriteText (viewwindowx + 2, y, line);
+		y += 8;
+	}
+}
+
+/*
+===================
+=
+= M_PoolUsage / M_PoolOverflow
+=
+===================
+*/
+
+void M_PoolUsage (pool_t p, int32_t used)
+{
+	if (poolpeak[p] < used)
+		poolpeak[p] = used;
+}
+
+void M_PoolOverflow (pool_t p)
+{
+	pooloverflows[p]++;
+}
+
+/*
+===================
+=
+= M_BenchDump
+=
+= Called on exit, after the video mode has been reset
+=
+===================
+*/
+
+void M_BenchDump (void)
+{
+	int32_t		p;
+	uint32_t	average;
+
+	if (results)
+		printf ("%s", results);
+
+	if (showlumpstats)
+		W_PrintLumpStats ();
+
+	if (!profiling || profframes < 2)
+		return;
+
+	printf ("\nProfile of %i frames, ms per frame\n", profframes - 1);
+	printf ("%-10s %8s %8s\n", "", "avg", "max");
+	for (p = 0; p < NUMPROFILES; p++)
+	{
+		average = proftotal[p] / (profframes - 1);
+		printf ("%-10s %4u.%.3u %4u.%.3u\n", profnames[p], MS(average), MS(profmax[p]));
+	}
+
+	printf ("\n%-10s %8s %9s\n", "pool", "peak", "overflows");
+	for (p = 0; p < NUMPOOLS; p++)
+		printf ("%-10s %8i %9i\n", poolnames[p], poolpeak[p], pooloverflows[p]);
+}
@@ -20,7 +20,9 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#if !defined __linux__
 #include <io.h>
+#endif
 #include <ctype.h>
 #include "doomdef.h"
 #include "r_local.h"
@@ -1464,6 +1466,13 @@ boolean M_Responder (event_t* ev)
 		G_ScreenShot ();
 		return true;
 	}
+
+	if (devparm && ch == KEY_F12)
+	{
+		Z_DumpHeap ("zone.txt");
+		players[consoleplayer].message = "zone dumped to zone.txt";
+		return true;
+	}
 		
     
 	// F-Keys
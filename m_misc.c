@@ -21,7 +21,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#if !defined __linux__
 #include <io.h>
+#endif
 #include "doomdef.h"
 #include "hu_stuff.h"
 #include "soundst.h"
@@ -88,7 +90,7 @@ static const uint8_t rndtable[256] = {
 	120, 163, 236, 249
 };
 int32_t rndindex = 0;
-static int32_t prndindex = 0;
+int32_t prndindex = 0;
 
 int32_t P_Random (void)
 {
@@ -298,6 +300,8 @@ static default_t defaults[] =
 
 	{"usegamma",&usegamma, 0},
 
+#if !defined __linux__
+
 	{"chatmacro0", (int32_t *) &chat_macros[0], (int32_t) HUSTR_CHATMACRO0 },
 	{"chatmacro1", (int32_t *) &chat_macros[1], (int32_t) HUSTR_CHATMACRO1 },
 	{"chatmacro2", (int32_t *) &chat_macros[2], (int32_t) HUSTR_CHATMACRO2 },
@@ -308,6 +312,7 @@ static default_t defaults[] =
 	{"chatmacro7", (int32_t *) &chat_macros[7], (int32_t) HUSTR_CHATMACRO7 },
 	{"chatmacro8", (int32_t *) &chat_macros[8], (int32_t) HUSTR_CHATMACRO8 },
 	{"chatmacro9", (int32_t *) &chat_macros[9], (int32_t) HUSTR_CHATMACRO9 }
+#endif
 };
 
 static int32_t numdefaults;
@@ -419,8 +424,8 @@ void M_LoadDefaults (void)
 					  if (!isstring)
 						*defaults[i].location = parm;
 					  else
-						*defaults[i].location =
-						  (int32_t) newstring;
+						* (char **) (defaults[i].location) =
+						  newstring;
 					  break;
 				  }
 			}
@@ -158,7 +158,7 @@ boolean EV_DoCeiling (line_t *line, ceiling_e  type)
 		// new door thinker
 		//
 		rtn = true;
-		ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVSPEC, 0);
+		ceiling = P_AllocThinker (sizeof(*ceiling));
 		P_AddThinker (&ceiling->thinker);
 		sec->specialdata = ceiling;
 		ceiling->thinker.function = T_MoveCeiling;
@@ -234,7 +234,7 @@ boolean EV_DoDoor(line_t *line, vldoor_e type)
 		}
 		// Add new door thinker
 		retcode = true;
-		door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+		door = P_AllocThinker (sizeof(*door));
 		P_AddThinker(&door->thinker);
 		sec->specialdata = door;
 		door->thinker.function = T_VerticalDoor;
@@ -401,7 +401,7 @@ void EV_VerticalDoor(line_t *line, mobj_t *thing)
 	//
 	// new door thinker
 	//
-	door = Z_Malloc (sizeof(*door), PU_LEVSPEC, 0);
+	door = P_AllocThinker (sizeof(*door));
 	P_AddThinker(&door->thinker);
 	sec->specialdata = door;
 	door->thinker.function = T_VerticalDoor;
@@ -451,7 +451,7 @@ void P_SpawnDoorCloseIn30(sector_t *sec)
 {
 	vldoor_t *door;
 
-	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+	door = P_AllocThinker (sizeof(*door));
 	P_AddThinker(&door->thinker);
 	sec->specialdata = door;
 	sec->special = 0;
@@ -472,7 +472,7 @@ void P_SpawnDoorRaiseIn5Mins(sector_t *sec)
 {
 	vldoor_t *door;
 
-	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+	door = P_AllocThinker (sizeof(*door));
 	P_AddThinker(&door->thinker);
 	sec->specialdata = door;
 	sec->special = 0;
@@ -234,7 +234,7 @@ boolean EV_DoFloor(line_t *line,floor_e floortype)
 		//	new floor thinker
 		//
 		rtn = true;
-		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+		floor = P_AllocThinker (sizeof(*floor));
 		P_AddThinker (&floor->thinker);
 		sec->specialdata = floor;
 		floor->thinker.function = T_MoveFloor;
@@ -411,7 +411,7 @@ boolean EV_BuildStairs(line_t *line, boolean build8)
 		// new floor thinker
 		//
 		rtn = true;
-		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+		floor = P_AllocThinker (sizeof(*floor));
 		P_AddThinker (&floor->thinker);
 		sec->specialdata = floor;
 		floor->thinker.function = T_MoveFloor;
@@ -459,7 +459,7 @@ boolean EV_BuildStairs(line_t *line, boolean build8)
 
 				sec = tsec;
 				secnum = newsecnum;
-				floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+				floor = P_AllocThinker (sizeof(*floor));
 				P_AddThinker (&floor->thinker);
 				sec->specialdata = floor;
 				floor->thinker.function = T_MoveFloor;
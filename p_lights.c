@@ -60,7 +60,7 @@ void P_SpawnFireFlicker  (sector_t *sector)
 	
 	sector->special = 0;		// nothing special about it during gameplay
 	
-	flick = Z_Malloc ( sizeof(*flick), PU_LEVSPEC, 0);
+	flick = P_AllocThinker (sizeof(*flick));
 	P_AddThinker (&flick->thinker);
 	flick->thinker.function = T_FireFlicker;
 	flick->sector = sector;
@@ -118,7 +118,7 @@ void P_SpawnLightFlash (sector_t *sector)
 	
 	sector->special = 0;		// nothing special about it during gameplay
 	
-	flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+	flash = P_AllocThinker (sizeof(*flash));
 	P_AddThinker (&flash->thinker);
 	flash->thinker.function = T_LightFlash;
 	flash->sector = sector;
@@ -172,7 +172,7 @@ void P_SpawnStrobeFlash (sector_t *sector,int32_t fastOrSlow, int32_t inSync)
 {
 	strobe_t	*flash;
 	
-	flash = Z_Malloc ( sizeof(*flash), PU_LEVSPEC, 0);
+	flash = P_AllocThinker (sizeof(*flash));
 	P_AddThinker (&flash->thinker);
 	flash->sector = sector;
 	flash->darktime = fastOrSlow;
@@ -314,7 +314,7 @@ void P_SpawnGlowingLight(sector_t *sector)
 {
 	glow_t	*g;
 	
-	g = Z_Malloc( sizeof(*g), PU_LEVSPEC, 0);
+	g = P_AllocThinker (sizeof(*g));
 	P_AddThinker(&g->thinker);
 	g->sector = sector;
 	g->minlight = P_FindMinSurroundingLight(sector);
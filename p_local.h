@@ -81,6 +81,9 @@ extern	thinker_t	thinkercap;	// both the head and tail of the thinker list
 
 
 void P_InitThinkers (void);
+void P_ClearThinkerPools (void);
+void *P_AllocThinker (int32_t size);
+void P_FreeThinker (thinker_t *thinker);
 void P_AddThinker (thinker_t *thinker);
 void P_RemoveThinker (thinker_t *thinker);
 
@@ -452,7 +452,39 @@ boolean P_BlockThingsIterator (int32_t x, int32_t y, boolean(*func)(mobj_t*) )
 ===============================================================================
 */
 
+#if defined REMOVE_LIMITS
+static intercept_t		*intercepts, *intercept_p;
+static int32_t			maxintercepts;
+
+/*
+==================
+=
+= P_CheckIntercepts
+=
+= Grows intercepts when it is full, it keeps its size for the next traces
+==================
+*/
+
+static void P_CheckIntercepts (void)
+{
+	int32_t		count;
+
+	if (intercept_p < intercepts + maxintercepts)
+		return;
+
+	if (maxintercepts)
+		M_PoolOverflow (pool_intercepts);
+
+	count = intercept_p - intercepts;
+	maxintercepts = maxintercepts ? maxintercepts * 2 : MAXINTERCEPTS;
+	intercepts = realloc (intercepts, maxintercepts * sizeof(*intercepts));
+	if (!intercepts)
+		I_Error ("P_CheckIntercepts: couldn't allocate %i intercepts", maxintercepts);
+	intercept_p = intercepts + count;
+}
+#else
 static intercept_t		intercepts[MAXINTERCEPTS], *intercept_p;
+#endif
 
 divline_t 	trace;
 static boolean 	earlyout;
@@ -502,6 +534,9 @@ static boolean PIT_AddLineIntercepts (line_t *ld)
 	if (earlyout && frac < FRACUNIT && !ld->backsector)
 		return false;	// stop checking
 	
+#if defined REMOVE_LIMITS
+	P_CheckIntercepts ();
+#endif
 	intercept_p->frac = frac;
 	intercept_p->isaline = true;
 	intercept_p->d.line = ld;
@@ -560,6 +595,9 @@ static boolean PIT_AddThingIntercepts (mobj_t	*thing)
 	frac = P_InterceptVector (&trace, &dl);
 	if (frac < 0)
 		return true;		// behind source
+#if defined REMOVE_LIMITS
+	P_CheckIntercepts ();
+#endif
 	intercept_p->frac = frac;
 	intercept_p->isaline = false;
 	intercept_p->d.thing = thing;
@@ -585,6 +623,12 @@ static void P_TraverseIntercepts ( traverser_t func, fixed_t maxfrac )
 	
 	count = intercept_p - intercepts;
 	in = NULL;			// shut up warning
+
+	M_PoolUsage (pool_intercepts, count);
+#if !defined REMOVE_LIMITS
+	if (count > MAXINTERCEPTS)
+		M_PoolOverflow (pool_intercepts);	// it has overrun whatever follows intercepts
+#endif
 	
 	while (count--)
 	{
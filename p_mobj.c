@@ -426,7 +426,7 @@ mobj_t *P_SpawnMobj (fixed_t x, fixed_t y, fixed_t z, mobjtype_t type)
 	state_t		*st;
 	mobjinfo_t	*info;
 
-	mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+	mobj = P_AllocThinker (sizeof(*mobj));
 	memset (mobj, 0, sizeof (*mobj));
 	info = &mobjinfo[type];
 	
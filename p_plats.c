@@ -141,7 +141,7 @@ boolean	EV_DoPlat(line_t *line,plattype_e type,int32_t amount)
 		// Find lowest & highest floors around sector
 		//
 		rtn = true;
-		plat = Z_Malloc( sizeof(*plat), PU_LEVSPEC, 0);
+		plat = P_AllocThinker (sizeof(*plat));
 		P_AddThinker(&plat->thinker);
 		
 		plat->type = type;
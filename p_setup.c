@@ -72,7 +72,7 @@ static void P_LoadVertexes (int32_t lump)
 	vertex_t	*li;
 	
 	numvertexes = W_LumpLength (lump) / sizeof(mapvertex_t);
-	vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);	
+	vertexes = Z_MallocLevel (numvertexes*sizeof(vertex_t));	
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
 	ml = (mapvertex_t *)data;
@@ -105,7 +105,7 @@ static void P_LoadSegs (int32_t lump)
 	int32_t		linedef, side;
 	
 	numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
-	segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);	
+	segs = Z_MallocLevel (numsegs*sizeof(seg_t));	
 	memset (segs, 0, numsegs*sizeof(seg_t));
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -150,7 +150,7 @@ static void P_LoadSubsectors (int32_t lump)
 	subsector_t		*ss;
 	
 	numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
-	subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);	
+	subsectors = Z_MallocLevel (numsubsectors*sizeof(subsector_t));	
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
 	ms = (mapsubsector_t *)data;
@@ -182,7 +182,7 @@ static void P_LoadSectors (int32_t lump)
 	sector_t		*ss;
 	
 	numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
-	sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);	
+	sectors = Z_MallocLevel (numsectors*sizeof(sector_t));	
 	memset (sectors, 0, numsectors*sizeof(sector_t));
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -220,7 +220,7 @@ static void P_LoadNodes (int32_t lump)
 	node_t		*no;
 	
 	numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
-	nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);	
+	nodes = Z_MallocLevel (numnodes*sizeof(node_t));	
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
 	mn = (mapnode_t *)data;
@@ -321,7 +321,7 @@ static void P_LoadLineDefs (int32_t lump)
 	vertex_t		*v1, *v2;
 	
 	numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
-	lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);	
+	lines = Z_MallocLevel (numlines*sizeof(line_t));	
 	memset (lines, 0, numlines*sizeof(line_t));
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -400,7 +400,7 @@ static void P_LoadSideDefs (int32_t lump)
 	side_t			*sd;
 	
 	numsides = W_LumpLength (lump) / sizeof(mapsidedef_t);
-	sides = Z_Malloc (numsides*sizeof(side_t),PU_LEVEL,0);	
+	sides = Z_MallocLevel (numsides*sizeof(side_t));	
 	memset (sides, 0, numsides*sizeof(side_t));
 	data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -433,7 +433,8 @@ static void P_LoadBlockMap (int32_t lump)
 {
 	int32_t		i, count;
 	
-	blockmaplump = W_CacheLumpNum (lump,PU_LEVEL);
+	blockmaplump = Z_MallocLevel (W_LumpLength (lump));
+	W_ReadLump (lump, blockmaplump);
 	blockmap = blockmaplump+4;
 	count = W_LumpLength (lump)/2;
 	for (i=0 ; i<count ; i++)
@@ -446,7 +447,7 @@ static void P_LoadBlockMap (int32_t lump)
 	
 // clear out mobj chains
 	count = sizeof(*blocklinks)* bmapwidth*bmapheight;
-	blocklinks = Z_Malloc (count,PU_LEVEL, 0);
+	blocklinks = Z_MallocLevel (count);
 	memset (blocklinks, 0, count);
 }
 
@@ -497,7 +498,7 @@ static void P_GroupLines (void)
 	}
 	
 // build line tables for each sector	
-	linebuffer = Z_Malloc (total*4, PU_LEVEL, 0);
+	linebuffer = Z_MallocLevel (total*sizeof(*linebuffer));
 	sector = sectors;
 	for (i=0 ; i<numsectors ; i++, sector++)
 	{
@@ -543,6 +544,60 @@ static void P_GroupLines (void)
 //=============================================================================
 
 
+/*
+=================
+=
+= P_MapLumpName
+=
+=================
+*/
+
+static void P_MapLumpName (char *lumpname, int32_t episode, int32_t map)
+{
+	if (commercial)
+	{
+		if (map<10)
+			sprintf (lumpname,"map0%i", map);
+		else
+			sprintf (lumpname,"map%i", map);
+	}
+	else
+	{
+		lumpname[0] = 'E';
+		lumpname[1] = '0' + episode;
+		lumpname[2] = 'M';
+		lumpname[3] = '0' + map;
+		lumpname[4] = 0;
+	}
+}
+
+/*
+=================
+=
+= P_PrefetchLevel
+=
+= Queues the lumps of a level, so they are read during the intermission
+=
+=================
+*/
+
+void P_PrefetchLevel (int32_t episode, int32_t map)
+{
+	char	lumpname[9];
+	int32_t	lumpnum;
+	int32_t	i;
+
+	P_MapLumpName (lumpname, episode, map);
+	lumpnum = W_CheckNumForName (lumpname);
+	if (lumpnum == -1)
+		return;
+
+	for (i=ML_THINGS ; i<=ML_BLOCKMAP ; i++)
+		W_PrefetchLump (lumpnum+i);
+
+	R_PrefetchLevel (lumpnum);
+}
+
 /*
 =================
 =
@@ -556,6 +611,7 @@ void P_SetupLevel (int32_t episode, int32_t map)
 	int32_t	i;
 	char	lumpname[9];
 	int32_t	lumpnum;
+	int32_t	maplumps[ML_BLOCKMAP-ML_THINGS+1];
 	
 	totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
 	wminfo.partime = 180;
@@ -569,34 +625,23 @@ void P_SetupLevel (int32_t episode, int32_t map)
 	S_Start ();			// make sure all sounds are stopped before Z_FreeTags
 	
 	R_ResetPlanes();
+	W_ClearPrefetch ();		// the queued lumps may be of another level
 	Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
+	P_ClearThinkerPools ();
 	
 	P_InitThinkers ();
 
 	// if working with a devlopment map, reload it
 	W_Reload ();	
 	
-//
-// find map name
-//
-	if (commercial)
-	{
-		if (map<10)
-			sprintf (lumpname,"map0%i", map);
-		else
-			sprintf (lumpname,"map%i", map);
-	}
-	else
-	{
-		lumpname[0] = 'E';
-		lumpname[1] = '0' + episode;
-		lumpname[2] = 'M';
-		lumpname[3] = '0' + map;
-		lumpname[4] = 0;
-	}
-	
+	P_MapLumpName (lumpname, episode, map);
 	lumpnum = W_GetNumForName (lumpname);
 
+	// the map lumps are stored back to back, read them at once
+	for (i=ML_THINGS ; i<=ML_BLOCKMAP ; i++)
+		maplumps[i-ML_THINGS] = lumpnum+i;
+	W_CacheLumpBatch (maplumps, ML_BLOCKMAP-ML_THINGS+1, PU_CACHE);
+
 	leveltime = 0;
 	
 // note: most of this ordering is important	
@@ -610,7 +655,8 @@ void P_SetupLevel (int32_t episode, int32_t map)
 	P_LoadNodes (lumpnum+ML_NODES);
 	P_LoadSegs (lumpnum+ML_SEGS);
 	
-	rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
+	rejectmatrix = Z_MallocLevel (W_LumpLength (lumpnum+ML_REJECT));
+	W_ReadLump (lumpnum+ML_REJECT, rejectmatrix);
 	P_GroupLines ();
 
 	bodyqueslot = 0;
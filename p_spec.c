@@ -905,7 +905,7 @@ boolean EV_DoDonut(line_t *line)
 			//
 			//	Spawn rising slime
 			//
-			floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+			floor = P_AllocThinker (sizeof(*floor));
 			P_AddThinker (&floor->thinker);
 			s2->specialdata = floor;
 			floor->thinker.function = T_MoveFloor;
@@ -921,7 +921,7 @@ boolean EV_DoDonut(line_t *line)
 			//
 			//	Spawn lowering donut-hole
 			//
-			floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+			floor = P_AllocThinker (sizeof(*floor));
 			P_AddThinker (&floor->thinker);
 			s1->specialdata = floor;
 			floor->thinker.function = T_MoveFloor;
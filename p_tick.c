@@ -25,10 +25,12 @@ extern boolean menuactive;
 
 int32_t leveltime;
 
+static FILE	*checksumtrace;
+
 
 // Pads save_p to a 4-byte boundary
 //  so that the load/save works on SGI&Gecko.
-#define PADSAVEP()	save_p += (4 - ((int32_t) save_p & 3)) & 3
+#define PADSAVEP()	save_p += (4 - ((intptr_t) save_p & 3)) & 3
 
 /*
 ====================
@@ -84,7 +86,7 @@ void P_UnArchivePlayers (void)
 		for (j=0 ; j<NUMPSPRITES ; j++)
 			if (players[i]. psprites[j].state)
 				players[i]. psprites[j].state 
-				= &states[ (int32_t)players[i].psprites[j].state ];
+				= &states[ (intptr_t)players[i].psprites[j].state ];
 	}
 }
 
@@ -275,8 +277,7 @@ void P_UnArchiveThinkers (void)
 		next = currentthinker->next;
 		if (currentthinker->function == P_MobjThinker)
 			P_RemoveMobj ((mobj_t *)currentthinker);
-		else
-			Z_Free (currentthinker);
+		P_FreeThinker (currentthinker);
 		currentthinker = next;
 	}
 	P_InitThinkers ();
@@ -292,14 +293,14 @@ void P_UnArchiveThinkers (void)
 			
 		case tc_mobj:
 			PADSAVEP();
-			mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+			mobj = P_AllocThinker (sizeof(*mobj));
 			memcpy (mobj, save_p, sizeof(*mobj));
 			save_p += sizeof(*mobj);
-			mobj->state = &states[(int32_t)mobj->state];
+			mobj->state = &states[(intptr_t)mobj->state];
 			mobj->target = NULL;
 			if (mobj->player)
 			{
-				mobj->player = &players[(int32_t)mobj->player-1];
+				mobj->player = &players[(intptr_t)mobj->player-1];
 				mobj->player->mo = mobj;
 			}
 			P_SetThingPosition (mobj);
@@ -488,10 +489,10 @@ void P_UnArchiveSpecials (void)
 			
 			case tc_ceiling:
 				PADSAVEP();
-				ceiling = Z_Malloc (sizeof(*ceiling), PU_LEVEL, NULL);
+				ceiling = P_AllocThinker (sizeof(*ceiling));
 				memcpy (ceiling, save_p, sizeof(*ceiling));
 				save_p += sizeof(*ceiling);
-				ceiling->sector = &sectors[(int32_t)ceiling->sector];
+				ceiling->sector = &sectors[(intptr_t)ceiling->sector];
 				ceiling->sector->specialdata = ceiling;
 				if (ceiling->thinker.function)
 					ceiling->thinker.function = T_MoveCeiling;
@@ -501,10 +502,10 @@ void P_UnArchiveSpecials (void)
 
 			case tc_door:
 				PADSAVEP();
-				door = Z_Malloc (sizeof(*door), PU_LEVEL, NULL);
+				door = P_AllocThinker (sizeof(*door));
 				memcpy (door, save_p, sizeof(*door));
 				save_p += sizeof(*door);
-				door->sector = &sectors[(int32_t)door->sector];
+				door->sector = &sectors[(intptr_t)door->sector];
 				door->sector->specialdata = door;
 				door->thinker.function = T_VerticalDoor;
 				P_AddThinker (&door->thinker);
@@ -512,10 +513,10 @@ void P_UnArchiveSpecials (void)
 
 			case tc_floor:
 				PADSAVEP();
-				floor = Z_Malloc (sizeof(*floor), PU_LEVEL, NULL);
+				floor = P_AllocThinker (sizeof(*floor));
 				memcpy (floor, save_p, sizeof(*floor));
 				save_p += sizeof(*floor);
-				floor->sector = &sectors[(int32_t)floor->sector];
+				floor->sector = &sectors[(intptr_t)floor->sector];
 				floor->sector->specialdata = floor;
 				floor->thinker.function = T_MoveFloor;
 				P_AddThinker (&floor->thinker);
@@ -523,10 +524,10 @@ void P_UnArchiveSpecials (void)
 				
 			case tc_plat:
 				PADSAVEP();
-				plat = Z_Malloc (sizeof(*plat), PU_LEVEL, NULL);
+				plat = P_AllocThinker (sizeof(*plat));
 				memcpy (plat, save_p, sizeof(*plat));
 				save_p += sizeof(*plat);
-				plat->sector = &sectors[(int32_t)plat->sector];
+				plat->sector = &sectors[(intptr_t)plat->sector];
 				plat->sector->specialdata = plat;
 				if (plat->thinker.function)
 					plat->thinker.function = T_PlatRaise;
@@ -536,30 +537,30 @@ void P_UnArchiveSpecials (void)
 				
 			case tc_flash:
 				PADSAVEP();
-				flash = Z_Malloc (sizeof(*flash), PU_LEVEL, NULL);
+				flash = P_AllocThinker (sizeof(*flash));
 				memcpy (flash, save_p, sizeof(*flash));
 				save_p += sizeof(*flash);
-				flash->sector = &sectors[(int32_t)flash->sector];
+				flash->sector = &sectors[(intptr_t)flash->sector];
 				flash->thinker.function = T_LightFlash;
 				P_AddThinker (&flash->thinker);
 				break;
 				
 			case tc_strobe:
 				PADSAVEP();
-				strobe = Z_Malloc (sizeof(*strobe), PU_LEVEL, NULL);
+				strobe = P_AllocThinker (sizeof(*strobe));
 				memcpy (strobe, save_p, sizeof(*strobe));
 				save_p += sizeof(*strobe);
-				strobe->sector = &sectors[(int32_t)strobe->sector];
+				strobe->sector = &sectors[(intptr_t)strobe->sector];
 				strobe->thinker.function = T_StrobeFlash;
 				P_AddThinker (&strobe->thinker);
 				break;
 				
 			case tc_glow:
 				PADSAVEP();
-				glow = Z_Malloc (sizeof(*glow), PU_LEVEL, NULL);
+				glow = P_AllocThinker (sizeof(*glow));
 				memcpy (glow, save_p, sizeof(*glow));
 				save_p += sizeof(*glow);
-				glow->sector = &sectors[(int32_t)glow->sector];
+				glow->sector = &sectors[(intptr_t)glow->sector];
 				glow->thinker.function = T_Glow;
 				P_AddThinker (&glow->thinker);
 				break;
@@ -580,14 +581,108 @@ void P_UnArchiveSpecials (void)
 
 								THINKERS
 
-All thinkers should be allocated by Z_Malloc so they can be operated on uniformly.  The actual
+All thinkers should be allocated by P_AllocThinker so they can be operated on uniformly.  The actual
 structures will vary in size, but the first element must be thinker_t.
 
+Every size of thinker has its own pool.  The pools take slabs from the level arena and keep
+the freed thinkers on a free list, so spawning and removing are constant time and the
+thinkers of a type sit close together.  Each thinker is preceded by the pool it came from.
+
 ===============================================================================
 */
 
 thinker_t	thinkercap;	// both the head and tail of the thinker list
 
+#define	MAXPOOLS		16
+#define	POOLSLAB		32		// thinkers per slab
+
+typedef struct
+{
+	int32_t		size;		// including the pool pointer
+	void		*freelist;	// linked through the first word of the thinker
+} thinkerpool_t;
+
+static thinkerpool_t	pools[MAXPOOLS];
+static int32_t			numpools;
+
+/*
+===============
+=
+= P_ClearThinkerPools
+=
+= Called after the level arena has been freed
+=
+===============
+*/
+
+void P_ClearThinkerPools (void)
+{
+	numpools = 0;
+}
+
+/*
+===============
+=
+= P_AllocThinker
+=
+===============
+*/
+
+void *P_AllocThinker (int32_t size)
+{
+	thinkerpool_t	*pool;
+	byte			*slab;
+	void			*thinker;
+	int32_t			i;
+
+	size = (size + sizeof(thinkerpool_t *) + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+	for (pool = pools; pool < pools + numpools; pool++)
+		if (pool->size == size)
+			break;
+	if (pool == pools + numpools)
+	{
+		if (numpools == MAXPOOLS)
+			I_Error ("P_AllocThinker: no more than %i thinker sizes", MAXPOOLS);
+		numpools++;
+		pool->size = size;
+		pool->freelist = NULL;
+	}
+
+	if (!pool->freelist)
+	{	// thread a new slab onto the free list
+		slab = Z_MallocLevel (size * POOLSLAB);
+		for (i = 0; i < POOLSLAB; i++, slab += size)
+		{
+			*(thinkerpool_t **)slab = pool;
+			thinker = slab + sizeof(thinkerpool_t *);
+			*(void **)thinker = pool->freelist;
+			pool->freelist = thinker;
+		}
+	}
+
+	thinker = pool->freelist;
+	pool->freelist = *(void **)thinker;
+	return thinker;
+}
+
+/*
+===============
+=
+= P_FreeThinker
+=
+===============
+*/
+
+void P_FreeThinker (thinker_t *thinker)
+{
+	thinkerpool_t	*pool;
+
+	pool = *(thinkerpool_t **)((byte *)thinker - sizeof(thinkerpool_t *));
+	*(void **)thinker = pool->freelist;
+	pool->freelist = thinker;
+}
+
 /*
 ===============
 =
@@ -646,26 +741,56 @@ void P_RemoveThinker (thinker_t *thinker)
 
 static void P_RunThinkers (void)
 {
-	thinker_t	*currentthinker;
+	thinker_t	*currentthinker, *nextthinker;
 
 	currentthinker = thinkercap.next;
 	while (currentthinker != &thinkercap)
 	{
+		nextthinker = currentthinker->next;
 		if (currentthinker->function == (think_t)-1)
 		{	// time to remove it
 			currentthinker->next->prev = currentthinker->prev;
 			currentthinker->prev->next = currentthinker->next;
-			Z_Free (currentthinker);
+			P_FreeThinker (currentthinker);	// the free list link overwrites the thinker
 		}
 		else
 		{
 			if (currentthinker->function)
 				currentthinker->function (currentthinker);
+			nextthinker = currentthinker->next;
 		}
-		currentthinker = currentthinker->next;
+		currentthinker = nextthinker;
 	}
 }
 
+/*
+=================
+=
+= P_ChecksumTrace
+=
+= -checksum <file> writes the gametic and P_Checksum of every tic,
+= eight little endian bytes per tic. The first difference between the
+= traces of two builds (cmp) is the tic where they desync: offset / 8.
+=
+=================
+*/
+
+void P_ChecksumTrace (char *name)
+{
+	checksumtrace = fopen (name, "wb");
+	if (!checksumtrace)
+		I_Error ("P_ChecksumTrace: couldn't create %s", name);
+}
+
+static void P_WriteChecksum (void)
+{
+	int32_t		record[2];
+
+	record[0] = LONG(gametic);
+	record[1] = LONG(P_Checksum ());
+	fwrite (record, sizeof(record), 1, checksumtrace);
+}
+
 /*
 =================
 =
@@ -694,9 +819,67 @@ void P_Ticker (void)
 		if (playeringame[i])
 			P_PlayerThink (&players[i]);
 
+	M_ProfileStart (prof_thinkers);
 	P_RunThinkers ();
+	M_ProfileStop (prof_thinkers);
 	P_UpdateSpecials ();
 	P_RespawnSpecials ();
 
 	leveltime++;	// for par times
+
+	if (checksumtrace)
+		P_WriteChecksum ();
+}
+
+/*
+=================
+=
+= P_Checksum
+=
+= Hashes the state a demo can desync on, so two builds can be compared
+=
+=================
+*/
+
+#define HASH(v)	sum = (sum ^ (uint32_t)(v)) * 16777619
+
+uint32_t P_Checksum (void)
+{
+	uint32_t	sum;
+	thinker_t	*th;
+	mobj_t		*mo;
+	sector_t	*sec;
+	int32_t		i;
+
+	sum = 2166136261u;
+
+	for (th = thinkercap.next; th != &thinkercap; th = th->next)
+	{
+		if (th->function != (think_t)P_MobjThinker)
+			continue;
+		mo = (mobj_t *)th;
+		HASH(mo->x);
+		HASH(mo->y);
+		HASH(mo->z);
+		HASH(mo->momx);
+		HASH(mo->momy);
+		HASH(mo->momz);
+		HASH(mo->angle);
+		HASH(mo->state - states);
+		HASH(mo->health);
+		HASH(mo->flags);
+		HASH(mo->type);
+	}
+
+	for (i = 0, sec = sectors; i < numsectors; i++, sec++)
+	{
+		HASH(sec->floorheight);
+		HASH(sec->ceilingheight);
+		HASH(sec->lightlevel);
+		HASH(sec->special);
+	}
+
+	HASH(prndindex);
+
+	return sum;
 }
@@ -26,7 +26,12 @@ side_t		*sidedef;
 line_t		*linedef;
 sector_t	*frontsector, *backsector;
 
+#if defined REMOVE_LIMITS
+drawseg_t	*drawsegs, *ds_p;
+static int32_t	maxdrawsegs;
+#else
 drawseg_t	drawsegs[MAXDRAWSEGS], *ds_p;
+#endif
 
 void R_StoreWallRange (int32_t start, int32_t stop);
 
@@ -43,6 +48,36 @@ void R_ClearDrawSegs (void)
 	ds_p = drawsegs;
 }
 
+#if defined REMOVE_LIMITS
+/*
+====================
+=
+= R_CheckDrawSegs
+=
+= Grows drawsegs when it is full, it keeps its size for the next frames
+=
+====================
+*/
+
+void R_CheckDrawSegs (void)
+{
+	int32_t		count;
+
+	if (ds_p < drawsegs + maxdrawsegs)
+		return;
+
+	if (maxdrawsegs)
+		M_PoolOverflow (pool_drawsegs);
+
+	count = ds_p - drawsegs;
+	maxdrawsegs = maxdrawsegs ? maxdrawsegs * 2 : MAXDRAWSEGS;
+	drawsegs = realloc (drawsegs, maxdrawsegs * sizeof(*drawsegs));
+	if (!drawsegs)
+		I_Error ("R_CheckDrawSegs: couldn't allocate %i drawsegs", maxdrawsegs);
+	ds_p = drawsegs + count;
+}
+#endif
+
 //=============================================================================
 
 
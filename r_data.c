@@ -72,9 +72,9 @@ lighttable_t	*colormaps;
 
 						MAPTEXTURE_T CACHING
 
-when a texture is first needed, it counts the number of composite columns
-required in the texture and allocates space for a column directory and any
-new columns.  The directory will simply point inside other patches if there
+when a texture is first needed by a level, it counts the number of composite
+columns required in the texture and allocates space for a column directory
+and any new columns.  The directory will simply point inside other patches if there
 is only one patch in a given column, but any columns with multiple patches
 will have new column_ts generated.
 
@@ -200,8 +200,8 @@ static void R_GenerateLookup (int32_t texnum)
 
 	texturecomposite[texnum] = 0;	// composited not created yet
 	texturecompositesize[texnum] = 0;
-	collump = texturecolumnlump[texnum];
-	colofs = texturecolumnofs[texnum];
+	collump = texturecolumnlump[texnum] = Z_Malloc (texture->width*2, PU_STATIC,0);
+	colofs = texturecolumnofs[texnum] = Z_Malloc (texture->width*2, PU_STATIC,0);
 	
 //
 // count the number of columns that are covered by more than one patch
@@ -263,6 +263,9 @@ byte *R_GetColumn (int32_t tex, int32_t col)
 {
 	int32_t	lump, ofs;
 	
+	if (!texturecolumnlump[tex])
+		R_GenerateLookup (tex);		// not seen by R_PrecacheLevel
+
 	col &= texturewidthmask[tex];
 	lump = texturecolumnlump[tex][col];
 	ofs = texturecolumnofs[tex][col];
@@ -270,6 +273,8 @@ byte *R_GetColumn (int32_t tex, int32_t col)
 		return (byte *)W_CacheLumpNum(lump,PU_CACHE)+ofs;
 	if (!texturecomposite[tex])
 		R_GenerateComposite (tex);
+	else
+		Z_Touch (texturecomposite[tex]);	// keeps a composite in view cached
 	return texturecomposite[tex] + ofs;
 }
 
@@ -338,13 +343,14 @@ static void R_InitTextures (void)
 	}
 	numtextures = numtextures1 + numtextures2;
 
-	textures = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	texturecolumnlump = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	texturecolumnofs = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	texturecomposite = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	texturecompositesize = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	texturewidthmask = Z_Malloc (numtextures*4, PU_STATIC, 0);
-	textureheight = Z_Malloc (numtextures*4, PU_STATIC, 0);
+	textures = Z_Malloc (numtextures*sizeof(*textures), PU_STATIC, 0);
+	texturecolumnlump = Z_Malloc (numtextures*sizeof(*texturecolumnlump), PU_STATIC, 0);
+	texturecolumnofs = Z_Malloc (numtextures*sizeof(*texturecolumnofs), PU_STATIC, 0);
+	memset (texturecolumnlump, 0, numtextures*sizeof(*texturecolumnlump));	// R_GenerateLookup on first use
+	texturecomposite = Z_Malloc (numtextures*sizeof(*texturecomposite), PU_STATIC, 0);
+	texturecompositesize = Z_Malloc (numtextures*sizeof(*texturecompositesize), PU_STATIC, 0);
+	texturewidthmask = Z_Malloc (numtextures*sizeof(*texturewidthmask), PU_STATIC, 0);
+	textureheight = Z_Malloc (numtextures*sizeof(*textureheight), PU_STATIC, 0);
 
 	totalwidth = 0;
     
@@ -392,8 +398,6 @@ static void R_InitTextures (void)
 				I_Error (
 				"R_InitTextures: Missing patch in texture %s",texture->name);
 		}		
-		texturecolumnlump[i] = Z_Malloc (texture->width*2, PU_STATIC,0);
-		texturecolumnofs[i] = Z_Malloc (texture->width*2, PU_STATIC,0);
 		j = 1;
 		while (j*2 <= texture->width)
 			j<<=1;
@@ -407,16 +411,10 @@ static void R_InitTextures (void)
 	if (maptex2)
 		Z_Free (maptex2);
 
-//
-// precalculate whatever possible
-//		
-	for (i=0 ; i<numtextures ; i++)
-		R_GenerateLookup(i);
-
 //
 // translation table for global animation
 //
-	texturetranslation = Z_Malloc ((numtextures+1)*4, PU_STATIC, 0);
+	texturetranslation = Z_Malloc ((numtextures+1)*sizeof(*texturetranslation), PU_STATIC, 0);
 	for (i=0 ; i<numtextures ; i++)
 		texturetranslation[i] = i;
 }
@@ -439,7 +437,7 @@ static void R_InitFlats (void)
 	numflats = lastflat - firstflat + 1;
 	
 // translation table for global animation
-	flattranslation = Z_Malloc ((numflats+1)*4, PU_STATIC, 0);
+	flattranslation = Z_Malloc ((numflats+1)*sizeof(*flattranslation), PU_STATIC, 0);
 	for (i=0 ; i<numflats ; i++)
 		flattranslation[i] = i;
 }
@@ -463,9 +461,9 @@ static void R_InitSpriteLumps (void)
 	firstspritelump = W_GetNumForName ("S_START") + 1;
 	lastspritelump = W_GetNumForName ("S_END") - 1;
 	numspritelumps = lastspritelump - firstspritelump + 1;
-	spritewidth = Z_Malloc (numspritelumps*4, PU_STATIC, 0);
-	spriteoffset = Z_Malloc (numspritelumps*4, PU_STATIC, 0);
-	spritetopoffset = Z_Malloc (numspritelumps*4, PU_STATIC, 0);
+	spritewidth = Z_Malloc (numspritelumps*sizeof(*spritewidth), PU_STATIC, 0);
+	spriteoffset = Z_Malloc (numspritelumps*sizeof(*spriteoffset), PU_STATIC, 0);
+	spritetopoffset = Z_Malloc (numspritelumps*sizeof(*spritetopoffset), PU_STATIC, 0);
 
 	for (i=0 ; i< numspritelumps ; i++)
 	{
@@ -497,7 +495,7 @@ static void R_InitColormaps (void)
 	lump = W_GetNumForName("COLORMAP");
 	length = W_LumpLength (lump) + 255;
 	colormaps = Z_Malloc (length, PU_STATIC, 0);
-	colormaps = (byte *)( ((int32_t)colormaps + 255)&~0xff);
+	colormaps = (byte *)( ((intptr_t)colormaps + 255)&~0xff);
 	W_ReadLump (lump,colormaps);
 }
 
@@ -593,6 +591,8 @@ int32_t	R_TextureNumForName (char *name)
 
 static int32_t		flatmemory, texturememory, spritememory;
 
+#define PRECACHE(l)	if (!lumppresent[l]) { lumppresent[l] = 1; lumps[numprecache++] = (l); }
+
 void R_PrecacheLevel (void)
 {
 	char			*flatpresent;
@@ -602,9 +602,43 @@ void R_PrecacheLevel (void)
 	texture_t		*texture;
 	thinker_t		*th;
 	spriteframe_t	*sf;
+	int32_t			*lumps;
+	char			*lumppresent;
+	int32_t			numprecache;
+
+//
+// build the textures of the level now, not in the frame that shows them first
+//
+	texturepresent = alloca(numtextures);
+	memset (texturepresent,0, numtextures);
+	
+	for (i=0 ; i<numsides ; i++)
+	{
+		texturepresent[sides[i].toptexture] = 1;
+		texturepresent[sides[i].midtexture] = 1;
+		texturepresent[sides[i].bottomtexture] = 1;
+	}
+	
+	texturepresent[skytexture] = 1;
+
+	for (i=0 ; i<numtextures ; i++)
+	{
+		if (!texturepresent[i])
+			continue;
+		if (!texturecolumnlump[i])
+			R_GenerateLookup (i);
+		if (texturecompositesize[i] && !texturecomposite[i])
+			R_GenerateComposite (i);
+	}
 
 	if (demoplayback)
 		return;
+
+	// the lumps are collected and read by a single W_CacheLumpBatch
+	lumps = Z_Malloc (numlumps*sizeof(*lumps), PU_STATIC, NULL);
+	lumppresent = alloca(numlumps);
+	memset (lumppresent,0,numlumps);
+	numprecache = 0;
 			
 //
 // precache flats
@@ -623,24 +657,12 @@ void R_PrecacheLevel (void)
 		{
 			lump = firstflat + i;
 			flatmemory += lumpinfo[lump].size;
-			W_CacheLumpNum(lump, PU_CACHE);
+			PRECACHE(lump);
 		}
 		
 //
 // precache textures
 //
-	texturepresent = alloca(numtextures);
-	memset (texturepresent,0, numtextures);
-	
-	for (i=0 ; i<numsides ; i++)
-	{
-		texturepresent[sides[i].toptexture] = 1;
-		texturepresent[sides[i].midtexture] = 1;
-		texturepresent[sides[i].bottomtexture] = 1;
-	}
-	
-	texturepresent[skytexture] = 1;
-	
 	texturememory = 0;
 	for (i=0 ; i<numtextures ; i++)
 	{
@@ -651,7 +673,7 @@ void R_PrecacheLevel (void)
 		{
 			lump = texture->patches[j].patch;
 			texturememory += lumpinfo[lump].size;
-			W_CacheLumpNum(lump , PU_CACHE);
+			PRECACHE(lump);
 		}
 	}
 	
@@ -679,12 +701,123 @@ void R_PrecacheLevel (void)
 			{
 				lump = firstspritelump + sf->lump[k];
 				spritememory += lumpinfo[lump].size;
-				W_CacheLumpNum(lump , PU_CACHE);
+				PRECACHE(lump);
 			}
 		}
 	}
+
+	W_CacheLumpBatch (lumps, numprecache, PU_CACHE);
+	Z_Free (lumps);
 }
 
 
 
 
+/*
+=================
+=
+= R_PrefetchLevel
+=
+= Queues the flats, texture patches and sprites a level will precache,
+= found from its map lumps before the level is loaded
+=
+=================
+*/
+
+void R_PrefetchLevel (int32_t lumpnum)
+{
+	char			*flatpresent;
+	char			*texturepresent;
+	char			*spritepresent;
+	int32_t			i,j,k, lump, count;
+	char			name[9];
+	mapsector_t		*ms;
+	mapsidedef_t	*msd;
+	mapthing_t		*mt;
+	texture_t		*texture;
+	spriteframe_t	*sf;
+
+	name[8] = 0;
+
+//
+// flats
+//
+	flatpresent = alloca(numflats);
+	memset (flatpresent,0,numflats);
+
+	ms = W_CacheLumpNum (lumpnum+ML_SECTORS, PU_STATIC);
+	count = W_LumpLength (lumpnum+ML_SECTORS) / sizeof(mapsector_t);
+	for (i=0 ; i<count ; i++, ms++)
+	{
+		memcpy (name, ms->floorpic, 8);
+		lump = W_CheckNumForName (name);
+		if (lump >= firstflat && lump < firstflat + numflats)
+			flatpresent[lump - firstflat] = 1;
+		memcpy (name, ms->ceilingpic, 8);
+		lump = W_CheckNumForName (name);
+		if (lump >= firstflat && lump < firstflat + numflats)
+			flatpresent[lump - firstflat] = 1;
+	}
+	Z_ChangeTag (ms - count, PU_CACHE);
+
+	for (i=0 ; i<numflats ; i++)
+		if (flatpresent[i])
+			W_PrefetchLump (firstflat + i);
+
+//
+// textures
+//
+	texturepresent = alloca(numtextures);
+	memset (texturepresent,0, numtextures);
+
+	msd = W_CacheLumpNum (lumpnum+ML_SIDEDEFS, PU_STATIC);
+	count = W_LumpLength (lumpnum+ML_SIDEDEFS) / sizeof(mapsidedef_t);
+	for (i=0 ; i<count ; i++, msd++)
+	{
+		if ((j = R_CheckTextureNumForName (msd->toptexture)) != -1)
+			texturepresent[j] = 1;
+		if ((j = R_CheckTextureNumForName (msd->midtexture)) != -1)
+			texturepresent[j] = 1;
+		if ((j = R_CheckTextureNumForName (msd->bottomtexture)) != -1)
+			texturepresent[j] = 1;
+	}
+	Z_ChangeTag (msd - count, PU_CACHE);
+
+	for (i=0 ; i<numtextures ; i++)
+	{
+		if (!texturepresent[i])
+			continue;
+		texture = textures[i];
+		for (j=0 ; j<texture->patchcount ; j++)
+			W_PrefetchLump (texture->patches[j].patch);
+	}
+
+//
+// sprites of the things that are spawned
+//
+	spritepresent = alloca(NUMSPRITES);
+	memset (spritepresent,0, NUMSPRITES);
+
+	mt = W_CacheLumpNum (lumpnum+ML_THINGS, PU_STATIC);
+	count = W_LumpLength (lumpnum+ML_THINGS) / sizeof(mapthing_t);
+	for (i=0 ; i<count ; i++, mt++)
+		for (j=0 ; j<NUMMOBJTYPES ; j++)
+			if (SHORT(mt->type) == mobjinfo[j].doomednum)
+			{
+				spritepresent[states[mobjinfo[j].spawnstate].sprite] = 1;
+				break;
+			}
+	Z_ChangeTag (mt - count, PU_CACHE);
+
+	for (i=0 ; i<NUMSPRITES ; i++)
+	{
+		if (!spritepresent[i])
+			continue;
+		for (j=0 ; j<sprites[i].numframes ; j++)
+		{
+			sf = &sprites[i].spriteframes[j];
+			for (k=0 ; k<(sf->rotate ? 8 : 1) ; k++)
+				W_PrefetchLump (firstspritelump + sf->lump[k]);
+		}
+	}
+}
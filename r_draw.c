@@ -20,8 +20,10 @@
 
 // R_draw.c
 
+#if !defined __linux__
 #include <conio.h>
 #include <dos.h>
+#endif
 #include "doomdef.h"
 #include "r_local.h"
 
@@ -38,7 +40,7 @@ files only know about ccordinates, not the architecture of the frame buffer.
 
 */
 
-int32_t viewwidth, scaledviewwidth, viewheight, viewwindowx, viewwindowy;
+int32_t viewwidth, scaledviewwidth, viewheight, scaledviewheight, viewwindowx, viewwindowy;
 
 /*
 ==================
@@ -50,15 +52,212 @@ int32_t viewwidth, scaledviewwidth, viewheight, viewwindowx, viewwindowy;
 ==================
 */
 
-lighttable_t	*dc_colormap	__attribute__ ((externally_visible));
-int32_t			dc_x			__attribute__ ((externally_visible));
-int32_t			dc_yl			__attribute__ ((externally_visible));
-int32_t			dc_yh			__attribute__ ((externally_visible));
-fixed_t			dc_iscale		__attribute__ ((externally_visible));
-fixed_t			dc_texturemid	__attribute__ ((externally_visible));
-byte			*dc_source		__attribute__ ((externally_visible));		// first pixel in a column (possibly virtual)
+THREADLOCAL lighttable_t	*dc_colormap	__attribute__ ((externally_visible));
+THREADLOCAL int32_t			dc_x			__attribute__ ((externally_visible));
+THREADLOCAL int32_t			dc_yl			__attribute__ ((externally_visible));
+THREADLOCAL int32_t			dc_yh			__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			dc_iscale		__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			dc_texturemid	__attribute__ ((externally_visible));
+THREADLOCAL byte			*dc_source		__attribute__ ((externally_visible));		// first pixel in a column (possibly virtual)
+
+#if defined LINEAR_FRAMEBUFFER
+void R_DrawColumn (void)
+{
+	int32_t		count;
+	byte		*dest;
+	fixed_t		frac, fracstep;	
+
+	count = dc_yh - dc_yl;
+	if (count < 0)
+		return;
+				
+#ifdef RANGECHECK
+	if ((uint32_t)dc_x >= RENDERWIDTH || dc_yl < 0 || dc_yh >= RENDERHEIGHT)
+		I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	dest = destview + dc_yl*RENDERWIDTH + dc_x;
+	
+	fracstep = dc_iscale;
+	frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+	do
+	{
+		*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+		dest += RENDERWIDTH;
+		frac += fracstep;
+	} while (count--);
+}
+
+void R_DrawColumnLow (void)
+{
+	int32_t		count;
+	byte		*dest;
+	fixed_t		frac, fracstep;	
+
+	count = dc_yh - dc_yl;
+	if (count < 0)
+		return;
+				
+#ifdef RANGECHECK
+	if ((uint32_t)dc_x >= RENDERWIDTH || dc_yl < 0 || dc_yh >= RENDERHEIGHT)
+		I_Error ("R_DrawColumnLow: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	dest = destview + dc_yl*RENDERWIDTH + (dc_x<<1);
+	
+	fracstep = dc_iscale;
+	frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+	do
+	{
+		dest[0] = dest[1] = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
+		dest += RENDERWIDTH;
+		frac += fracstep;
+	} while (count--);
+}
+
+/*
+==================
+=
+= R_DrawColumnBatch
+=
+= High detail colfunc, collects up to four adjacent columns with the
+= same colormap, from a multiple of four up to the next one
+= R_FlushColumns draws the rows they share a word at a time and
+= the rest of every column on its own
+=
+= Flush before anything else can draw over the columns or before
+= their sources can be purged
+=
+==================
+*/
+
+typedef struct
+{
+	int32_t		yl, yh;
+	fixed_t		frac, fracstep;		// frac at yl
+	byte		*source;
+} batchcolumn_t;
+
+static batchcolumn_t	batchcolumns[4];
+static int32_t			numbatchcolumns;
+static int32_t			batchx;
+static lighttable_t		*batchcolormap;
+
+static void R_DrawBatchRows (batchcolumn_t *col, int32_t x, int32_t yl, int32_t yh)
+{
+	byte		*dest;
+	fixed_t		frac;
+
+	dest = destview + yl*RENDERWIDTH + x;
+	frac = col->frac + (uint32_t)col->fracstep * (yl - col->yl);
+
+	for ( ; yl <= yh; yl++)
+	{
+		*dest = batchcolormap[col->source[(frac>>FRACBITS)&127]];
+		dest += RENDERWIDTH;
+		frac += col->fracstep;
+	}
+}
+
+void R_FlushColumns (void)
+{
+	batchcolumn_t	*col;
+	int32_t			i, top, bottom;
+	uint32_t		*dest;
+	fixed_t			frac0, frac1, frac2, frac3;
+
+	if (!numbatchcolumns)
+		return;
+
+	top = batchcolumns[0].yl;
+	bottom = batchcolumns[0].yh;
+	if (numbatchcolumns == 4 && !(batchx & 3))
+	{
+		for (i = 1; i < 4; i++)
+		{
+			if (top < batchcolumns[i].yl)
+				top = batchcolumns[i].yl;
+			if (bottom > batchcolumns[i].yh)
+				bottom = batchcolumns[i].yh;
+		}
+	}
+	else
+		bottom = top - 1;		// no shared rows
+
+	for (i = 0, col = batchcolumns; i < numbatchcolumns; i++, col++)
+	{
+		if (top > bottom)
+			R_DrawBatchRows (col, batchx+i, col->yl, col->yh);
+		else
+		{
+			R_DrawBatchRows (col, batchx+i, col->yl, top-1);
+			R_DrawBatchRows (col, batchx+i, bottom+1, col->yh);
+		}
+	}
+
+	if (top <= bottom)
+	{
+		dest = (uint32_t *)(destview + top*RENDERWIDTH + batchx);
+		col = batchcolumns;
+		frac0 = col[0].frac + (uint32_t)col[0].fracstep * (top - col[0].yl);
+		frac1 = col[1].frac + (uint32_t)col[1].fracstep * (top - col[1].yl);
+		frac2 = col[2].frac + (uint32_t)col[2].fracstep * (top - col[2].yl);
+		frac3 = col[3].frac + (uint32_t)col[3].fracstep * (top - col[3].yl);
+
+		// the targets are little endian, the leftmost pixel is the low byte
+		for ( ; top <= bottom; top++)
+		{
+			*dest = batchcolormap[col[0].source[(frac0>>FRACBITS)&127]]
+				| batchcolormap[col[1].source[(frac1>>FRACBITS)&127]] << 8
+				| batchcolormap[col[2].source[(frac2>>FRACBITS)&127]] << 16
+				| (uint32_t)batchcolormap[col[3].source[(frac3>>FRACBITS)&127]] << 24;
+			dest += RENDERWIDTH/4;
+			frac0 += col[0].fracstep;
+			frac1 += col[1].fracstep;
+			frac2 += col[2].fracstep;
+			frac3 += col[3].fracstep;
+		}
+	}
+
+	numbatchcolumns = 0;
+}
+
+void R_DrawColumnBatch (void)
+{
+	batchcolumn_t	*col;
+
+	if (dc_yh < dc_yl)
+		return;
 
-#if defined C_ONLY
+#ifdef RANGECHECK
+	if ((uint32_t)dc_x >= RENDERWIDTH || dc_yl < 0 || dc_yh >= RENDERHEIGHT)
+		I_Error ("R_DrawColumnBatch: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	if (numbatchcolumns
+		&& (dc_x != batchx + numbatchcolumns || dc_colormap != batchcolormap))
+		R_FlushColumns ();
+
+	if (!numbatchcolumns)
+	{
+		batchx = dc_x;
+		batchcolormap = dc_colormap;
+	}
+
+	col = &batchcolumns[numbatchcolumns++];
+	col->yl = dc_yl;
+	col->yh = dc_yh;
+	col->fracstep = dc_iscale;
+	col->frac = dc_texturemid + (dc_yl-centery)*dc_iscale;
+	col->source = dc_source;
+
+	if (!((batchx + numbatchcolumns) & 3))
+		R_FlushColumns ();
+}
+
+#elif defined C_ONLY
 void R_DrawColumn (void)
 {
 	int32_t		count;
@@ -123,11 +322,17 @@ void R_DrawColumnLow (void)
 
 
 #define FUZZTABLE	50
-#define FUZZOFF	(PLANEWIDTH)
+#if defined LINEAR_FRAMEBUFFER
+#define FUZZOFF		1
+#define FUZZPITCH	RENDERWIDTH
+#else
+#define FUZZOFF		(PLANEWIDTH)
+#define FUZZPITCH	1
+#endif
 static const int32_t		fuzzoffset[FUZZTABLE] = {
 FUZZOFF,-FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,-FUZZOFF,-FUZZOFF,-FUZZOFF,FUZZOFF,-FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,-FUZZOFF,-FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF
 };
-static int32_t fuzzpos = 0;
+static THREADLOCAL int32_t fuzzpos = 0;
 
 void R_DrawFuzzColumn (void)
 {
@@ -145,10 +350,13 @@ void R_DrawFuzzColumn (void)
 		return;
 				
 #ifdef RANGECHECK
-	if ((uint32_t)dc_x >= SCREENWIDTH || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+	if ((uint32_t)dc_x >= RENDERWIDTH || dc_yl < 0 || dc_yh >= RENDERHEIGHT)
 		I_Error ("R_DrawFuzzColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
 #endif
 
+#if defined LINEAR_FRAMEBUFFER
+	dest = destview + dc_yl*RENDERWIDTH + (dc_x<<detailshift);
+#else
 	if (detailshift)
 	{
 		if (dc_x & 1)
@@ -169,17 +377,21 @@ void R_DrawFuzzColumn (void)
 		outp (SC_INDEX+1,1<<(dc_x&3)); 
 		dest = destview + dc_yl*PLANEWIDTH + (dc_x>>2); 
 	}
+#endif
 
 	fracstep = dc_iscale;
 	frac = dc_texturemid + (dc_yl-centery)*fracstep;
 
 	do
 	{
-		*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]];
+		*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*FUZZPITCH]];
+#if defined LINEAR_FRAMEBUFFER
+		dest[detailshift] = *dest;	// low detail doubles the pixel
+#endif
 		if (++fuzzpos == FUZZTABLE)
 			fuzzpos = 0;
 
-		dest += PLANEWIDTH;
+		dest += FUZZOFF*FUZZPITCH;
 		frac += fracstep;
 	} while (count--);
 }
@@ -192,7 +404,7 @@ void R_DrawFuzzColumn (void)
 ========================
 */
 
-byte *dc_translation;
+THREADLOCAL byte *dc_translation;
 byte *translationtables;
 
 void R_DrawTranslatedColumn (void)
@@ -206,10 +418,13 @@ void R_DrawTranslatedColumn (void)
 		return;
 				
 #ifdef RANGECHECK
-	if ((uint32_t)dc_x >= SCREENWIDTH || dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+	if ((uint32_t)dc_x >= RENDERWIDTH || dc_yl < 0 || dc_yh >= RENDERHEIGHT)
 		I_Error ("R_DrawTranslatedColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
 #endif
 
+#if defined LINEAR_FRAMEBUFFER
+	dest = destview + dc_yl*RENDERWIDTH + (dc_x<<detailshift);
+#else
 	if (detailshift)
 	{
 		if (dc_x & 1)
@@ -224,6 +439,7 @@ void R_DrawTranslatedColumn (void)
 		outp (SC_INDEX+1,1<<(dc_x&3)); 
 		dest = destview + dc_yl*PLANEWIDTH + (dc_x>>2); 
 	}
+#endif
 	
 	fracstep = dc_iscale;
 	frac = dc_texturemid + (dc_yl-centery)*fracstep;
@@ -231,7 +447,12 @@ void R_DrawTranslatedColumn (void)
 	do
 	{
 		*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
+#if defined LINEAR_FRAMEBUFFER
+		dest[detailshift] = *dest;	// low detail doubles the pixel
+		dest += RENDERWIDTH;
+#else
 		dest += PLANEWIDTH;
+#endif
 		frac += fracstep;
 	} while (count--);
 }
@@ -249,7 +470,7 @@ void R_InitTranslationTables (void)
 	int32_t		i;
 
 	translationtables = Z_Malloc (256*3+255, PU_STATIC, 0);
-	translationtables = (byte *)(( (int32_t)translationtables + 255 )& ~255);
+	translationtables = (byte *)(( (intptr_t)translationtables + 255 )& ~255);
 
 //
 // translate just the 16 green colors
@@ -278,17 +499,90 @@ void R_InitTranslationTables (void)
 ================
 */
 
-int32_t			ds_y			__attribute__ ((externally_visible));
-int32_t			ds_x1			__attribute__ ((externally_visible));
-int32_t			ds_x2			__attribute__ ((externally_visible));
-lighttable_t	*ds_colormap	__attribute__ ((externally_visible));
-fixed_t			ds_xfrac		__attribute__ ((externally_visible));
-fixed_t			ds_yfrac		__attribute__ ((externally_visible));
-fixed_t			ds_xstep		__attribute__ ((externally_visible));
-fixed_t			ds_ystep		__attribute__ ((externally_visible));
-byte			*ds_source		__attribute__ ((externally_visible));		// start of a 64*64 tile image
-
-#if defined C_ONLY
+THREADLOCAL int32_t			ds_y			__attribute__ ((externally_visible));
+THREADLOCAL int32_t			ds_x1			__attribute__ ((externally_visible));
+THREADLOCAL int32_t			ds_x2			__attribute__ ((externally_visible));
+THREADLOCAL lighttable_t	*ds_colormap	__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			ds_xfrac		__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			ds_yfrac		__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			ds_xstep		__attribute__ ((externally_visible));
+THREADLOCAL fixed_t			ds_ystep		__attribute__ ((externally_visible));
+THREADLOCAL byte			*ds_source		__attribute__ ((externally_visible));		// start of a 64*64 tile image
+
+#if defined LINEAR_FRAMEBUFFER
+void R_DrawSpan (void) 
+{ 
+	fixed_t		xfrac, yfrac;
+	byte		*dest;
+	int32_t		spot;
+	int32_t		count;
+
+#ifdef RANGECHECK 
+	if (ds_x2 < ds_x1
+		|| ds_x1<0
+		|| ds_x2>=RENDERWIDTH  
+		|| (uint32_t)ds_y>RENDERHEIGHT)
+	{
+		I_Error( "R_DrawSpan: %i to %i at %i",
+				 ds_x1,ds_x2,ds_y);
+	} 
+#endif 
+
+	dest = destview + ds_y*RENDERWIDTH + ds_x1;
+	count = ds_x2 - ds_x1;
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	do
+	{
+		// Current texture index in u,v.
+		spot = ((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63);
+
+		// Lookup pixel from flat texture tile,
+		//  re-index using light/colormap.
+		*dest++ = ds_colormap[ds_source[spot]];
+		// Next step in u,v.
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+	} while (count--);
+}
+
+void R_DrawSpanLow (void) 
+{ 
+	fixed_t		xfrac, yfrac;
+	byte		*dest;
+	int32_t		spot;
+	int32_t		count;
+
+#ifdef RANGECHECK 
+	if (ds_x2 < ds_x1
+		|| ds_x1<0
+		|| ds_x2>=RENDERWIDTH  
+		|| (uint32_t)ds_y>RENDERHEIGHT)
+	{
+		I_Error( "R_DrawSpanLow: %i to %i at %i",
+				 ds_x1,ds_x2,ds_y);
+	} 
+#endif 
+
+	dest = destview + ds_y*RENDERWIDTH + (ds_x1<<1);
+	count = ds_x2 - ds_x1;
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	do
+	{
+		spot = ((yfrac>>(16-6))&(63*64)) + ((xfrac>>16)&63);
+		dest[0] = dest[1] = ds_colormap[ds_source[spot]];
+		dest += 2;
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+	} while (count--);
+}
+
+#elif defined C_ONLY
 void R_DrawSpan (void) 
 { 
     fixed_t		xfrac;
@@ -420,6 +714,358 @@ void R_DrawSpanLow (void)
 #endif
 
 
+#if defined RENDER_THREADS
+/*
+==============================================================================
+
+						DRAW RECORDS
+
+With -threads the refresh records the columns and spans instead of drawing
+them. R_DrawRecords splits the view in vertical strips, one per worker, and
+every worker draws the records of its strip in the recorded order, so the
+frame is the same as with one thread.
+Only the drawers run in parallel. The BSP walk, the clipping, the visplanes,
+the drawsegs and the vissprites stay on the main thread, there are no copies
+of them per worker.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	void			(*drawer) (void);
+	int32_t			x1, x2;			// dc_x for columns
+	int32_t			yl, yh;			// ds_y in yl for spans
+	fixed_t			frac, fracstep;	// dc_texturemid and dc_iscale, or ds_xfrac and ds_xstep
+	fixed_t			yfrac, ystep;	// spans only
+	byte			*source;
+	lighttable_t	*colormap;
+	byte			*translation;
+	int32_t			fuzzpos;
+} drawrecord_t;
+
+int32_t				renderthreads = 1;
+
+static drawrecord_t	*drawrecords;
+static int32_t		numdrawrecords, maxdrawrecords;
+
+static drawrecord_t *R_NewRecord (void (*drawer) (void))
+{
+	drawrecord_t	*rec;
+
+	if (numdrawrecords == maxdrawrecords)
+	{
+		maxdrawrecords = maxdrawrecords ? maxdrawrecords * 2 : 4096;
+		drawrecords = realloc (drawrecords, maxdrawrecords * sizeof(*drawrecords));
+		if (!drawrecords)
+			I_Error ("R_NewRecord: couldn't allocate %i records", maxdrawrecords);
+	}
+
+	rec = &drawrecords[numdrawrecords++];
+	rec->drawer = drawer;
+	return rec;
+}
+
+static drawrecord_t *R_RecordColumnWith (void (*drawer) (void))
+{
+	drawrecord_t	*rec;
+
+	rec = R_NewRecord (drawer);
+	rec->x1 = rec->x2 = dc_x;
+	rec->yl = dc_yl;
+	rec->yh = dc_yh;
+	rec->frac = dc_texturemid;
+	rec->fracstep = dc_iscale;
+	rec->source = dc_source;
+	rec->colormap = dc_colormap;
+	rec->translation = dc_translation;
+	return rec;
+}
+
+static void R_RecordColumn (void)
+{
+	R_RecordColumnWith (detailshift ? R_DrawColumnLow : R_DrawColumn);
+}
+
+static void R_RecordTranslatedColumn (void)
+{
+	R_RecordColumnWith (R_DrawTranslatedColumn);
+}
+
+static void R_RecordFuzzColumn (void)
+{
+	drawrecord_t	*rec;
+	int32_t			yl, yh;
+
+	rec = R_RecordColumnWith (R_DrawFuzzColumn);
+	rec->fuzzpos = fuzzpos;
+
+	// step fuzzpos like R_DrawFuzzColumn, for the next fuzz column
+	yl = dc_yl ? dc_yl : 1;
+	yh = dc_yh == viewheight-1 ? viewheight-2 : dc_yh;
+	if (yh >= yl)
+		fuzzpos = (fuzzpos + yh - yl + 1) % FUZZTABLE;
+}
+
+static void R_RecordSpan (void)
+{
+	drawrecord_t	*rec;
+
+	rec = R_NewRecord (detailshift ? R_DrawSpanLow : R_DrawSpan);
+	rec->x1 = ds_x1;
+	rec->x2 = ds_x2;
+	rec->yl = ds_y;
+	rec->frac = ds_xfrac;
+	rec->fracstep = ds_xstep;
+	rec->yfrac = ds_yfrac;
+	rec->ystep = ds_ystep;
+	rec->source = ds_source;
+	rec->colormap = ds_colormap;
+}
+
+/*
+================
+=
+= R_SetRecorders
+=
+= Called by R_ExecuteSetViewSize after it has set the drawers
+=
+================
+*/
+
+void R_SetRecorders (void)
+{
+	if (renderthreads < 2)
+		return;
+
+	colfunc = basecolfunc = R_RecordColumn;
+	fuzzcolfunc = R_RecordFuzzColumn;
+	transcolfunc = R_RecordTranslatedColumn;
+	spanfunc = R_RecordSpan;
+}
+
+/*
+================
+=
+= R_DrawStrip
+=
+= Strips start at a multiple of 8, so two workers never write
+= the same byte of a plane
+=
+================
+*/
+
+static void R_DrawStrip (int32_t worker)
+{
+	drawrecord_t	*rec, *end;
+	int32_t			x1, x2, skip;
+
+	x1 = (viewwidth * worker / renderthreads) & ~7;
+	if (worker == renderthreads - 1)
+		x2 = viewwidth - 1;
+	else
+		x2 = ((viewwidth * (worker + 1) / renderthreads) & ~7) - 1;
+
+	end = drawrecords + numdrawrecords;
+	for (rec = drawrecords; rec < end; rec++)
+	{
+		if (rec->x2 < x1 || rec->x1 > x2)
+			continue;
+
+		if (rec->drawer == R_DrawSpan || rec->drawer == R_DrawSpanLow)
+		{
+			// the same fractions as stepping from the start of the span
+			skip = rec->x1 < x1 ? x1 - rec->x1 : 0;
+			ds_x1 = rec->x1 + skip;
+			ds_x2 = rec->x2 < x2 ? rec->x2 : x2;
+			ds_y = rec->yl;
+			ds_xfrac = rec->frac + (uint32_t)rec->fracstep * skip;
+			ds_yfrac = rec->yfrac + (uint32_t)rec->ystep * skip;
+			ds_xstep = rec->fracstep;
+			ds_ystep = rec->ystep;
+			ds_source = rec->source;
+			ds_colormap = rec->colormap;
+		}
+		else
+		{
+			dc_x = rec->x1;
+			dc_yl = rec->yl;
+			dc_yh = rec->yh;
+			dc_texturemid = rec->frac;
+			dc_iscale = rec->fracstep;
+			dc_source = rec->source;
+			dc_colormap = rec->colormap;
+			dc_translation = rec->translation;
+			fuzzpos = rec->fuzzpos;
+		}
+		rec->drawer ();
+	}
+}
+
+/*
+================
+=
+= R_DrawRecords
+=
+================
+*/
+
+void R_DrawRecords (void)
+{
+	if (!numdrawrecords)
+		return;
+
+	I_RunWorkers (R_DrawStrip);
+	numdrawrecords = 0;
+}
+#endif
+
+
+#if defined LINEAR_FRAMEBUFFER || defined RENDER_THREADS
+/*
+================
+=
+= R_FlushDrawers
+=
+= Called before Z_Malloc purges, the batched columns and the records
+= point into cached lumps
+=
+================
+*/
+
+void R_FlushDrawers (void)
+{
+#if defined LINEAR_FRAMEBUFFER
+	R_FlushColumns ();
+#endif
+#if defined RENDER_THREADS
+	R_DrawRecords ();
+#endif
+}
+#endif
+
+
+#if defined RENDER_RESOLUTION
+/*
+==============================================================================
+
+						RENDER RESOLUTION
+
+With -resolution the view is rendered into renderscreen, a multiple of
+320x200. R_ScaleDownView copies every renderscale'th pixel of the view into
+screens[0], so the 2D layers, the border erasing and screenshots work as
+before. R_DrawScaledFrame scales screens[0] back up and uses the rendered
+view wherever V_MarkRect didn't mark that a 2D layer drew over the copy.
+
+==============================================================================
+*/
+
+int32_t		renderscale = 1;
+byte		*renderscreen;				// NULL draws the view into screens[0]
+static boolean	viewrendered;
+
+/*
+================
+=
+= R_SetResolution
+=
+================
+*/
+
+void R_SetResolution (char *resolution)
+{
+	int32_t		width, height;
+
+	if (sscanf (resolution, "%ix%i", &width, &height) != 2
+		|| width % SCREENWIDTH || width / SCREENWIDTH * SCREENHEIGHT != height
+		|| width < SCREENWIDTH || width > MAXRENDERWIDTH)
+		I_Error ("R_SetResolution: %s isn't 320x200 up to %ix%i in steps of 320x200",
+			resolution, MAXRENDERWIDTH, MAXRENDERHEIGHT);
+
+	renderscale = width / SCREENWIDTH;
+	if (renderscale == 1)
+		return;
+
+	renderscreen = malloc (RENDERWIDTH*RENDERHEIGHT);
+	if (!renderscreen)
+		I_Error ("R_SetResolution: couldn't allocate %ix%i", RENDERWIDTH, RENDERHEIGHT);
+	memset (renderscreen, 0, RENDERWIDTH*RENDERHEIGHT);
+	printf ("R_SetResolution: %ix%i\n", RENDERWIDTH, RENDERHEIGHT);
+}
+
+/*
+================
+=
+= R_ScaleDownView
+=
+= Called at the end of R_RenderPlayerView
+=
+================
+*/
+
+void R_ScaleDownView (void)
+{
+	byte		*src, *dest;
+	int32_t		x, y;
+
+	if (!renderscreen)
+		return;
+
+	for (y = 0; y < scaledviewheight; y++)
+	{
+		src = renderscreen + ((viewwindowy+y)*RENDERWIDTH + viewwindowx)*renderscale;
+		dest = screens[0] + (viewwindowy+y)*SCREENWIDTH + viewwindowx;
+		for (x = 0; x < scaledviewwidth; x++)
+			dest[x] = src[x*renderscale];
+	}
+
+	V_ClearDirtyRows ();
+	viewrendered = true;
+}
+
+/*
+================
+=
+= R_DrawScaledFrame
+=
+= A pixel of the view that no 2D layer has drawn on since R_ScaleDownView
+= becomes the block it was copied from
+=
+================
+*/
+
+void R_DrawScaledFrame (byte *dest)
+{
+	byte		*src, *view;
+	int32_t		x, y, i, j;
+	boolean		inview;
+
+	src = screens[0];
+	for (y = 0; y < SCREENHEIGHT; y++, dest += RENDERWIDTH*renderscale)
+	{
+		inview = viewrendered && y >= viewwindowy && y < viewwindowy + scaledviewheight;
+		for (x = 0; x < SCREENWIDTH; x++, src++)
+		{
+			view = renderscreen + (y*RENDERWIDTH + x)*renderscale;
+			if (inview && x >= viewwindowx && x < viewwindowx + scaledviewwidth
+				&& (x < dirtyleft[y] || x > dirtyright[y]))
+			{
+				for (j = 0; j < renderscale; j++)
+					memcpy (dest + j*RENDERWIDTH + x*renderscale, view + j*RENDERWIDTH, renderscale);
+			}
+			else
+			{
+				for (j = 0; j < renderscale; j++)
+					for (i = 0; i < renderscale; i++)
+						dest[j*RENDERWIDTH + x*renderscale + i] = *src;
+			}
+		}
+	}
+
+	viewrendered = false;
+}
+#endif
+
 
 /*
 ================
@@ -487,23 +1133,25 @@ void R_FillBackScreen (void)
 		V_DrawPatch (viewwindowx+x,viewwindowy-8,1,patch);
 	patch = W_CacheLumpName ("brdr_b",PU_CACHE);
 	for (x=0 ; x<scaledviewwidth ; x+=8)
-		V_DrawPatch (viewwindowx+x,viewwindowy+viewheight,1,patch);
+		V_DrawPatch (viewwindowx+x,viewwindowy+scaledviewheight,1,patch);
 	patch = W_CacheLumpName ("brdr_l",PU_CACHE);
-	for (y=0 ; y<viewheight ; y+=8)
+	for (y=0 ; y<scaledviewheight ; y+=8)
 		V_DrawPatch (viewwindowx-8,viewwindowy+y,1,patch);
 	patch = W_CacheLumpName ("brdr_r",PU_CACHE);
-	for (y=0 ; y<viewheight ; y+=8)
+	for (y=0 ; y<scaledviewheight ; y+=8)
 		V_DrawPatch (viewwindowx+scaledviewwidth,viewwindowy+y,1,patch);
 
 	V_DrawPatch (viewwindowx-8, viewwindowy-8, 1,
 		W_CacheLumpName ("brdr_tl",PU_CACHE));
 	V_DrawPatch (viewwindowx+scaledviewwidth, viewwindowy-8, 1,
 		W_CacheLumpName ("brdr_tr",PU_CACHE));
-	V_DrawPatch (viewwindowx-8, viewwindowy+viewheight, 1,
+	V_DrawPatch (viewwindowx-8, viewwindowy+scaledviewheight, 1,
 		W_CacheLumpName ("brdr_bl",PU_CACHE));
-	V_DrawPatch (viewwindowx+scaledviewwidth, viewwindowy+viewheight, 1,
+	V_DrawPatch (viewwindowx+scaledviewwidth, viewwindowy+scaledviewheight, 1,
 		W_CacheLumpName ("brdr_br",PU_CACHE));
 
+#if !defined LINEAR_FRAMEBUFFER
+	// R_VideoErase copies from video memory, so the pattern is kept there
 	dest = (byte*)(0xac000 + __djgpp_conventional_base);
 	src = screens[1];
 	for (i = 0; i < 4; i++, src++)
@@ -513,9 +1161,16 @@ void R_FillBackScreen (void)
 		for (j = 0; j < (SCREENHEIGHT-SBARHEIGHT)*SCREENWIDTH/4; j++)
 			dest[j] = src[j*4];
 	}
+#endif
 }
 
 
+#if defined LINEAR_FRAMEBUFFER
+void R_VideoErase (uint32_t ofs, int32_t count)
+{
+	memcpy (screens[0]+ofs, screens[1]+ofs, count);
+}
+#else
 void R_VideoErase (uint32_t ofs, int32_t count)
 { 
 	int32_t		i;
@@ -533,6 +1188,7 @@ void R_VideoErase (uint32_t ofs, int32_t count)
 	outp (GC_INDEX, GC_MODE);
 	outp (GC_INDEX+1, inp (GC_INDEX+1)&~1);
 }
+#endif
 
 
 /*
@@ -552,7 +1208,7 @@ void R_DrawViewBorder (void)
 	if (scaledviewwidth == SCREENWIDTH)
 		return;
   
-	top = ((SCREENHEIGHT-SBARHEIGHT)-viewheight)/2;
+	top = ((SCREENHEIGHT-SBARHEIGHT)-scaledviewheight)/2;
 	side = (SCREENWIDTH-scaledviewwidth)/2;
 
 //
@@ -563,7 +1219,7 @@ void R_DrawViewBorder (void)
 //
 // copy one line of right side and bottom
 //
-	ofs = (viewheight+top)*SCREENWIDTH-side;
+	ofs = (scaledviewheight+top)*SCREENWIDTH-side;
 	R_VideoErase (ofs, top*SCREENWIDTH+side);
  
 //
@@ -572,7 +1228,7 @@ void R_DrawViewBorder (void)
 	ofs = top*SCREENWIDTH + SCREENWIDTH-side;
 	side <<= 1;
     
-	for (i=1 ; i<viewheight ; i++)
+	for (i=1 ; i<scaledviewheight ; i++)
 	{
 		R_VideoErase (ofs, side);
 		ofs += SCREENWIDTH;
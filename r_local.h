@@ -141,7 +141,15 @@ typedef struct
 
 typedef byte	lighttable_t;		// this could be wider for >8 bit display
 
-#define	MAXOPENINGS		SCREENWIDTH*64
+#define	MAXOPENINGS		MAXRENDERWIDTH*64
+
+#if MAXRENDERHEIGHT > 255
+typedef uint16_t	planerow_t;
+#define	NOPLANEROW		0xffff
+#else
+typedef byte		planerow_t;
+#define	NOPLANEROW		0xff
+#endif
 
 typedef struct visplane_s
 {
@@ -151,12 +159,12 @@ typedef struct visplane_s
 	int32_t		picnum;
 	int32_t		lightlevel;
 	int32_t		minx, maxx;
-	byte		pad1;						// leave pads for [minx-1]/[maxx+1]
-	byte		top[SCREENWIDTH];
-	byte		pad2;
-	byte		pad3;
-	byte		bottom[SCREENWIDTH];
-	byte		pad4;
+	planerow_t	pad1;						// leave pads for [minx-1]/[maxx+1]
+	planerow_t	top[MAXRENDERWIDTH];
+	planerow_t	pad2;
+	planerow_t	pad3;
+	planerow_t	bottom[MAXRENDERWIDTH];
+	planerow_t	pad4;
 } visplane_t;
 
 typedef struct drawseg_s
@@ -254,7 +262,7 @@ extern	player_t	*viewplayer;
 extern	angle_t		clipangle;
 
 extern	int32_t		viewangletox[FINEANGLES/2];
-extern	angle_t		xtoviewangle[SCREENWIDTH+1];
+extern	angle_t		xtoviewangle[MAXRENDERWIDTH+1];
 extern	fixed_t		finetangent[FINEANGLES/2];
 
 extern	fixed_t		rw_distance;
@@ -285,6 +293,7 @@ extern	int32_t			detailshift;		// 0 = high, 1 = low
 extern	void		(*colfunc) (void);
 extern	void		(*basecolfunc) (void);
 extern	void		(*fuzzcolfunc) (void);
+extern	void		(*transcolfunc) (void);
 extern	void		(*spanfunc) (void);
 
 int32_t	R_PointOnSide (fixed_t x, fixed_t y, node_t *node);
@@ -304,7 +313,14 @@ extern	side_t	*sidedef;
 extern	line_t	*linedef;
 extern	sector_t	*frontsector, *backsector;
 
+#if defined REMOVE_LIMITS
+extern	drawseg_t	*drawsegs, *ds_p;
+
+void R_CheckDrawSegs (void);
+// makes room for one more drawseg at ds_p
+#else
 extern	drawseg_t	drawsegs[MAXDRAWSEGS], *ds_p;
+#endif
 
 extern	lighttable_t	**hscalelight, **vscalelight, **dscalelight;
 
@@ -332,11 +348,16 @@ extern	int32_t		skyflatnum;
 
 extern	int16_t		*lastopening;
 
-extern	int16_t		floorclip[SCREENWIDTH];
-extern	int16_t		ceilingclip[SCREENWIDTH];
+#if defined REMOVE_LIMITS
+void R_CheckOpenings (int32_t count);
+// makes room for count openings at lastopening
+#endif
+
+extern	int16_t		floorclip[MAXRENDERWIDTH];
+extern	int16_t		ceilingclip[MAXRENDERWIDTH];
 
-extern	fixed_t		yslope[SCREENHEIGHT];
-extern	fixed_t		distscale[SCREENWIDTH];
+extern	fixed_t		yslope[MAXRENDERHEIGHT];
+extern	fixed_t		distscale[MAXRENDERWIDTH];
 
 void R_ClearPlanes (void);
 void R_DrawPlanes (void);
@@ -353,7 +374,7 @@ extern	fixed_t		*spritewidth;		// needed for pre rendering (fracs)
 extern	fixed_t		*spriteoffset;
 extern	fixed_t		*spritetopoffset;
 extern	lighttable_t	*colormaps;
-extern	int32_t		viewwidth, scaledviewwidth, viewheight;
+extern	int32_t		viewwidth, scaledviewwidth, viewheight, scaledviewheight;
 extern	int32_t			firstflat;
 //extern	int32_t			numflats;
 
@@ -365,11 +386,12 @@ extern	int32_t		firstspritelump, lastspritelump;
 byte	*R_GetColumn (int32_t tex, int32_t col);
 void	R_InitData (void);
 void R_PrecacheLevel (void);
+void R_PrefetchLevel (int32_t lumpnum);
 
 
 // constant arrays used for psprite clipping and initializing clipping
-extern	int16_t	negonearray[SCREENWIDTH];
-extern	int16_t	screenheightarray[SCREENWIDTH];
+extern	int16_t	negonearray[MAXRENDERWIDTH];
+extern	int16_t	screenheightarray[MAXRENDERWIDTH];
 
 // vars for R_DrawMaskedColumn
 extern	int16_t		*mfloorclip;
@@ -397,35 +419,55 @@ void	R_ClipVisSprite (vissprite_t *vis, int32_t xl, int32_t xh);
 //
 //=============================================================================
 
-extern	lighttable_t	*dc_colormap;
-extern	int32_t			dc_x;
-extern	int32_t			dc_yl;
-extern	int32_t			dc_yh;
-extern	fixed_t			dc_iscale;
-extern	fixed_t			dc_texturemid;
-extern	byte			*dc_source;		// first pixel in a column
+extern	THREADLOCAL	lighttable_t	*dc_colormap;
+extern	THREADLOCAL	int32_t			dc_x;
+extern	THREADLOCAL	int32_t			dc_yl;
+extern	THREADLOCAL	int32_t			dc_yh;
+extern	THREADLOCAL	fixed_t			dc_iscale;
+extern	THREADLOCAL	fixed_t			dc_texturemid;
+extern	THREADLOCAL	byte			*dc_source;		// first pixel in a column
 
 void 	R_DrawColumn (void);
 void 	R_DrawColumnLow (void);
 void 	R_DrawFuzzColumn (void);
 void	R_DrawTranslatedColumn (void);
 
-extern	int32_t			ds_y;
-extern	int32_t			ds_x1;
-extern	int32_t			ds_x2;
-extern	lighttable_t	*ds_colormap;
-extern	fixed_t			ds_xfrac;
-extern	fixed_t			ds_yfrac;
-extern	fixed_t			ds_xstep;
-extern	fixed_t			ds_ystep;
-extern	byte			*ds_source;		// start of a 64*64 tile image
+#if defined LINEAR_FRAMEBUFFER
+void	R_DrawColumnBatch (void);
+// the high detail colfunc batches adjacent columns, see R_FlushColumns
+#endif
+
+extern	THREADLOCAL	int32_t			ds_y;
+extern	THREADLOCAL	int32_t			ds_x1;
+extern	THREADLOCAL	int32_t			ds_x2;
+extern	THREADLOCAL	lighttable_t	*ds_colormap;
+extern	THREADLOCAL	fixed_t			ds_xfrac;
+extern	THREADLOCAL	fixed_t			ds_yfrac;
+extern	THREADLOCAL	fixed_t			ds_xstep;
+extern	THREADLOCAL	fixed_t			ds_ystep;
+extern	THREADLOCAL	byte			*ds_source;		// start of a 64*64 tile image
 
 extern	byte	*translationtables;
-extern	byte	*dc_translation;
+extern	THREADLOCAL	byte	*dc_translation;
 
 void 	R_DrawSpan (void);
 void 	R_DrawSpanLow (void);
 
+#if defined RENDER_RESOLUTION
+void	R_ScaleDownView (void);
+// copies the view into screens[0] for the 2D layers
+#endif
+
+#if defined RENDER_THREADS
+void	R_SetRecorders (void);
+// -threads replaces the drawers by recorders, R_DrawRecords draws the records
+#endif
+
+#if defined LINEAR_FRAMEBUFFER || defined RENDER_THREADS
+void	R_FlushDrawers (void);
+// the zone's purge hook, draws what still points into cached lumps
+#endif
+
 void 	R_InitBuffer (int32_t width, int32_t height);
 void	R_InitTranslationTables (void);
 void R_FillBackScreen (void);
@@ -59,7 +59,7 @@ int32_t			viewangletox[FINEANGLES/2];
 
 // The xtoviewangleangle[] table maps a screen pixel to the lowest viewangle
 // that maps back to x ranges from clipangle to -clipangle
-angle_t		xtoviewangle[SCREENWIDTH+1];
+angle_t		xtoviewangle[MAXRENDERWIDTH+1];
 
 // the finetangentgent[angle+FINEANGLES/4] table holds the fixed_t tangent
 // values for view angles, ranging from MININT to 0 to MAXINT.
@@ -78,7 +78,7 @@ int32_t			extralight;			// bumped light from gun blasts
 void		(*colfunc) (void);
 void		(*basecolfunc) (void);
 void		(*fuzzcolfunc) (void);
-static void		(*transcolfunc) (void);
+void		(*transcolfunc) (void);
 void		(*spanfunc) (void);
 
 /*
@@ -472,16 +472,17 @@ void R_ExecuteSetViewSize (void)
 	if (setblocks == 11)
 	{
 		scaledviewwidth = SCREENWIDTH;
-		viewheight = SCREENHEIGHT;
+		scaledviewheight = SCREENHEIGHT;
 	}
 	else
 	{
 		scaledviewwidth = setblocks*32;
-		viewheight = (setblocks*168/10)&~7;
+		scaledviewheight = (setblocks*168/10)&~7;
 	}
 
 	detailshift = setdetail;
-	viewwidth = scaledviewwidth>>detailshift;
+	viewwidth = (scaledviewwidth*RENDERWIDTH/SCREENWIDTH)>>detailshift;
+	viewheight = scaledviewheight*RENDERHEIGHT/SCREENHEIGHT;
 
 	centery = viewheight/2;
 	centerx = viewwidth/2;
@@ -491,7 +492,11 @@ void R_ExecuteSetViewSize (void)
 
 	if (!detailshift)
 	{
+#if defined LINEAR_FRAMEBUFFER
+		colfunc = basecolfunc = R_DrawColumnBatch;
+#else
 		colfunc = basecolfunc = R_DrawColumn;
+#endif
 		fuzzcolfunc = R_DrawFuzzColumn;
 		transcolfunc = R_DrawTranslatedColumn;
 		spanfunc = R_DrawSpan;
@@ -504,7 +509,11 @@ void R_ExecuteSetViewSize (void)
 		spanfunc = R_DrawSpanLow;
 	}
 
-	R_InitBuffer (scaledviewwidth, viewheight);
+#if defined RENDER_THREADS
+	R_SetRecorders ();
+#endif
+
+	R_InitBuffer (scaledviewwidth, scaledviewheight);
 
 	R_InitTextureMapping ();
 
@@ -582,6 +591,15 @@ void R_Init (void)
 	printf (".");
 	R_InitTranslationTables();
 	framecount = 0;
+
+#if defined LINEAR_FRAMEBUFFER || defined RENDER_THREADS
+	Z_SetPurgeHook (R_FlushDrawers);
+#endif
+
+#if defined RENDER_THREADS
+	if (renderthreads > 1)
+		renderthreads = I_StartWorkers (renderthreads);
+#endif
 }
 
 
@@ -648,7 +666,16 @@ static void R_SetupFrame (player_t *player)
 	framecount++;
 	validcount++;
 
+#if defined RENDER_RESOLUTION
+	if (renderscreen)
+		destview = renderscreen+(viewwindowx+viewwindowy*RENDERWIDTH)*renderscale;
+	else
+		destview = destscreen+viewwindowx+viewwindowy*SCREENWIDTH;
+#elif defined LINEAR_FRAMEBUFFER
+	destview = destscreen+viewwindowx+viewwindowy*SCREENWIDTH;
+#else
 	destview = destscreen+(viewwindowx>>2)+viewwindowy*PLANEWIDTH;
+#endif
 }
 
 /*
@@ -667,10 +694,26 @@ void R_RenderPlayerView (player_t *player)
 	R_ClearPlanes ();
 	R_ClearSprites ();
 	NetUpdate ();					// check for new console commands
+	M_ProfileStart (prof_bsp);
 	R_RenderBSPNode (numnodes-1);	// the head node is the last node output
+	M_ProfileStop (prof_bsp);
 	NetUpdate ();					// check for new console commands
+	M_ProfileStart (prof_planes);
 	R_DrawPlanes ();
+	M_ProfileStop (prof_planes);
 	NetUpdate ();					// check for new console commands
+	M_ProfileStart (prof_masked);
 	R_DrawMasked ();
+	M_ProfileStop (prof_masked);
+#if defined RENDER_THREADS
+	M_ProfileStart (prof_records);
+	R_DrawRecords ();
+	M_ProfileStop (prof_records);
+#endif
+#if defined RENDER_RESOLUTION
+	M_ProfileStart (prof_scale);
+	R_ScaleDownView ();
+	M_ProfileStop (prof_scale);
+#endif
 	NetUpdate ();					// check for new console commands
 }
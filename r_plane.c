@@ -37,6 +37,7 @@ static int32_t	skytexturemid;
 #if defined REMOVE_LIMITS
 #define VISPLANEBUCKETS	32
 static visplane_t*		visplanes[VISPLANEBUCKETS];
+static int32_t			numvisplanes;	// allocated for the level
 #else
 #define	MAXVISPLANES	128
 static visplane_t		visplanes[MAXVISPLANES];
@@ -45,7 +46,21 @@ static visplane_t		visplanes[MAXVISPLANES];
 static visplane_t		*drawvisplane;
 visplane_t		*floorplane, *ceilingplane;
 
+#if defined REMOVE_LIMITS
+//
+// the drawsegs point into the openings, so they can't move during a frame
+// a frame that runs out gets another block, the next frame starts with
+// one block as big as all the openings of the previous frame
+//
+#define MAXOPENINGBLOCKS	32
+static int16_t	*openingblocks[MAXOPENINGBLOCKS];
+static int32_t	numopeningblocks;
+static int16_t	*openings, *openingsend;
+static int32_t	openingsused;		// in the previous blocks of this frame
+static int32_t	lastframeopenings;
+#else
 static int16_t	openings[MAXOPENINGS];
+#endif
 int16_t			*lastopening;
 
 //
@@ -53,14 +68,14 @@ int16_t			*lastopening;
 // floorclip starts out SCREENHEIGHT
 // ceilingclip starts out -1
 //
-int16_t		floorclip[SCREENWIDTH];
-int16_t		ceilingclip[SCREENWIDTH];
+int16_t		floorclip[MAXRENDERWIDTH];
+int16_t		ceilingclip[MAXRENDERWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-static int32_t			spanstart[SCREENHEIGHT];
+static int32_t			spanstart[MAXRENDERHEIGHT];
 
 //
 // texture mapping
@@ -68,14 +83,44 @@ static int32_t			spanstart[SCREENHEIGHT];
 static lighttable_t	**planezlight;
 static fixed_t		planeheight;
 
-fixed_t		yslope[SCREENHEIGHT];
-fixed_t		distscale[SCREENWIDTH];
+fixed_t		yslope[MAXRENDERHEIGHT];
+fixed_t		distscale[MAXRENDERWIDTH];
 static fixed_t		basexscale, baseyscale;
 
-static fixed_t		cachedheight[SCREENHEIGHT];
-static fixed_t		cacheddistance[SCREENHEIGHT];
-static fixed_t		cachedxstep[SCREENHEIGHT];
-static fixed_t		cachedystep[SCREENHEIGHT];
+static fixed_t		cachedheight[MAXRENDERHEIGHT];
+static fixed_t		cacheddistance[MAXRENDERHEIGHT];
+static fixed_t		cachedxstep[MAXRENDERHEIGHT];
+static fixed_t		cachedystep[MAXRENDERHEIGHT];
+
+//
+// R_DrawPlanes maps the flats sorted by flat, light level and height, and
+// draws the spans a row at a time after that, or whenever the spans are full
+// visplanes never overlap, the order doesn't change the frame
+//
+#define	MAXPLANESPANS	4096
+
+typedef struct
+{
+	int32_t			next;			// next span of the row, 0 ends the row
+	int32_t			x1, x2;
+	fixed_t			xfrac, yfrac;
+	fixed_t			xstep, ystep;
+	byte			*source;
+	lighttable_t	*colormap;
+} planespan_t;
+
+static planespan_t	*planespans;	// span 0 is unused
+static int32_t		numplanespans = 1;
+static int32_t		rowspans[MAXRENDERHEIGHT];	// last span of every row
+
+#if defined REMOVE_LIMITS
+static visplane_t	**sortedplanes;
+static byte			**planeflats;	// the flats held PU_STATIC until the spans are drawn
+static int32_t		maxsortedplanes;
+#else
+static visplane_t	*sortedplanes[MAXVISPLANES];
+static byte			*planeflats[MAXVISPLANES];
+#endif
 
 
 /*
@@ -97,7 +142,11 @@ void R_InitVisplanes(void)
 {
 #if !defined REMOVE_LIMITS
 	int32_t i;
+#endif
 
+	planespans = Z_Malloc (MAXPLANESPANS * sizeof(*planespans), PU_STATIC, NULL);
+
+#if !defined REMOVE_LIMITS
 	for (i = 0; i < MAXVISPLANES - 1; i++)
 	{
 		visplanes[i].next   = &visplanes[i + 1];
@@ -114,10 +163,83 @@ void R_ResetPlanes(void)
 {
 #if defined REMOVE_LIMITS
 	memset(visplanes, 0, sizeof(visplanes));
+	numvisplanes = 0;
 #endif
 }
 
 
+/*
+================
+=
+= R_DrawPlaneSpans
+=
+================
+*/
+
+static void R_DrawPlaneSpans (void)
+{
+	planespan_t	*span;
+	int32_t		y, i;
+
+	for (y = 0; y < viewheight; y++)
+	{
+		ds_y = y;
+		for (i = rowspans[y]; i; i = span->next)
+		{
+			span = &planespans[i];
+			ds_x1 = span->x1;
+			ds_x2 = span->x2;
+			ds_xfrac = span->xfrac;
+			ds_yfrac = span->yfrac;
+			ds_xstep = span->xstep;
+			ds_ystep = span->ystep;
+			ds_source = span->source;
+			ds_colormap = span->colormap;
+			spanfunc ();		// high or low detail
+		}
+		rowspans[y] = 0;
+	}
+
+	numplanespans = 1;
+}
+
+
+/*
+================
+=
+= R_AddPlaneSpan
+=
+= Adds the span in ds_ to the spans of row y
+=
+================
+*/
+
+static void R_AddPlaneSpan (int32_t y, int32_t x1, int32_t x2)
+{
+	planespan_t	*span;
+	byte		*source;
+
+	span = &planespans[numplanespans];
+	span->next = rowspans[y];
+	rowspans[y] = numplanespans++;
+	span->x1 = x1;
+	span->x2 = x2;
+	span->xfrac = ds_xfrac;
+	span->yfrac = ds_yfrac;
+	span->xstep = ds_xstep;
+	span->ystep = ds_ystep;
+	span->source = ds_source;
+	span->colormap = ds_colormap;
+
+	if (numplanespans == MAXPLANESPANS)
+	{	// drawing the spans changes ds_, the plane keeps its flat
+		source = ds_source;
+		R_DrawPlaneSpans ();
+		ds_source = source;
+	}
+}
+
+
 /*
 ================
 =
@@ -177,15 +299,57 @@ static void R_MapPlane (int32_t y, int32_t x1, int32_t x2)
 		ds_colormap = planezlight[index];
 	}
 	
-	ds_y = y;
-	ds_x1 = x1;
-	ds_x2 = x2;
-	
-	spanfunc ();		// high or low detail
+	R_AddPlaneSpan (y, x1, x2);
 }
 
 //=============================================================================
 
+#if defined REMOVE_LIMITS
+/*
+====================
+=
+= R_NewOpeningBlock
+=
+====================
+*/
+
+static void R_NewOpeningBlock (int32_t size)
+{
+	if (numopeningblocks == MAXOPENINGBLOCKS)
+		I_Error ("R_NewOpeningBlock: more than %i blocks", MAXOPENINGBLOCKS);
+
+	openings = malloc (size * sizeof(*openings));
+	if (!openings)
+		I_Error ("R_NewOpeningBlock: couldn't allocate %i openings", size);
+	openingblocks[numopeningblocks++] = openings;
+	openingsend = openings + size;
+	lastopening = openings;
+}
+
+/*
+====================
+=
+= R_CheckOpenings
+=
+====================
+*/
+
+void R_CheckOpenings (int32_t count)
+{
+	int32_t	size;
+
+	if (lastopening + count <= openingsend)
+		return;
+
+	M_PoolOverflow (pool_openings);
+	openingsused += lastopening - openings;
+	size = (openingsend - openings) * 2;
+	if (size < count)
+		size = count;
+	R_NewOpeningBlock (size);
+}
+#endif
+
 /*
 ====================
 =
@@ -210,6 +374,15 @@ void R_ClearPlanes (void)
 	}
 
 	drawvisplane = NULL;
+#if defined REMOVE_LIMITS
+	if (numopeningblocks != 1)
+	{
+		while (numopeningblocks)
+			free (openingblocks[--numopeningblocks]);
+		R_NewOpeningBlock (lastframeopenings > MAXOPENINGS ? lastframeopenings : MAXOPENINGS);
+	}
+	openingsused = 0;
+#endif
 	lastopening = openings;
 	
 //
@@ -231,7 +404,7 @@ static void setVisplaneData(visplane_t* visplane, fixed_t height, int32_t picnum
 	visplane->lightlevel = lightlevel;
 	visplane->minx       = minx;
 	visplane->maxx       = maxx;
-	memset(visplane->top, 0xff, sizeof(visplane->top));
+	memset(visplane->top, 0xff, RENDERWIDTH*sizeof(*visplane->top));
 
 	visplane->drawnext = drawvisplane;
 	drawvisplane = visplane;
@@ -286,17 +459,18 @@ visplane_t *R_FindPlane (fixed_t height, int32_t picnum, int32_t lightlevel)
 		}
 		else
 		{
-			setVisplaneData(check, height, picnum, lightlevel, SCREENWIDTH, -1);
+			setVisplaneData(check, height, picnum, lightlevel, RENDERWIDTH, -1);
 			return check;
 		}
 	}
 
-	check = Z_Malloc(sizeof(visplane_t), PU_LEVEL, NULL);
-	memset(check->bottom, 0, sizeof(check->bottom));
+	check = Z_MallocLevel(sizeof(visplane_t));
+	memset(check, 0, sizeof(visplane_t));	// R_DrawPlanes reads the pads next to bottom
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
+	numvisplanes++;
 
-	setVisplaneData(check, height, picnum, lightlevel, SCREENWIDTH, -1);
+	setVisplaneData(check, height, picnum, lightlevel, RENDERWIDTH, -1);
 	return check;
 #else
 	check = &visplanes[hash];
@@ -310,7 +484,7 @@ visplane_t *R_FindPlane (fixed_t height, int32_t picnum, int32_t lightlevel)
 
 		if (check->picnum == UNUSED_VISPLANE)
 		{
-			setVisplaneData(check, height, picnum, lightlevel, SCREENWIDTH, -1);
+			setVisplaneData(check, height, picnum, lightlevel, RENDERWIDTH, -1);
 			return check;
 		}
 
@@ -362,7 +536,7 @@ visplane_t *R_CheckPlane (visplane_t *pl, int32_t start, int32_t stop)
 	}
 
 	for (x=intrl ; x<= intrh ; x++)
-		if (pl->top[x] != 0xff)
+		if (pl->top[x] != NOPLANEROW)
 			break;
 
 	if (x > intrh)
@@ -394,10 +568,11 @@ visplane_t *R_CheckPlane (visplane_t *pl, int32_t start, int32_t stop)
 		}
 	}
 
-	check = Z_Malloc(sizeof(visplane_t), PU_LEVEL, NULL);
-	memset(check->bottom, 0, sizeof(check->bottom));
+	check = Z_MallocLevel(sizeof(visplane_t));
+	memset(check, 0, sizeof(visplane_t));	// R_DrawPlanes reads the pads next to bottom
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
+	numvisplanes++;
 
 	setVisplaneData(check, pl->height, pl->picnum, pl->lightlevel, start, stop);
 	return check;
@@ -461,6 +636,27 @@ static void R_MakeSpans (int32_t x, int32_t t1, int32_t b1, int32_t t2, int32_t
 
 
 
+/*
+================
+=
+= R_ComparePlanes
+=
+================
+*/
+
+static int R_ComparePlanes (const void *a, const void *b)
+{
+	const visplane_t	*pa = *(visplane_t * const *)a;
+	const visplane_t	*pb = *(visplane_t * const *)b;
+
+	if (flattranslation[pa->picnum] != flattranslation[pb->picnum])
+		return flattranslation[pa->picnum] < flattranslation[pb->picnum] ? -1 : 1;
+	if (pa->lightlevel != pb->lightlevel)
+		return pa->lightlevel < pb->lightlevel ? -1 : 1;
+	return pa->height < pb->height ? -1 : pa->height > pb->height;
+}
+
+
 /*
 ================
 =
@@ -476,14 +672,43 @@ void R_DrawPlanes (void)
 	int32_t		light;
 	int32_t		x, stop;
 	int32_t		angle;
+	int32_t		i, numplanes, numflats;
 
-#ifdef RANGECHECK
+#if defined REMOVE_LIMITS
+	lastframeopenings = openingsused + (lastopening - openings);
+	M_PoolUsage (pool_openings, lastframeopenings);
+#else
+	M_PoolUsage (pool_openings, lastopening - openings);
+	if (lastopening - openings > MAXOPENINGS)
+		M_PoolOverflow (pool_openings);
+#endif
+	M_PoolUsage (pool_drawsegs, ds_p - drawsegs);
+
+#if defined RANGECHECK && !defined REMOVE_LIMITS
 	if (ds_p - drawsegs > MAXDRAWSEGS)
 		I_Error ("R_DrawPlanes: drawsegs overflow (%i)", ds_p - drawsegs);
 	if (lastopening - openings > MAXOPENINGS)
 		I_Error ("R_DrawPlanes: opening overflow (%i)", lastopening - openings);
 #endif
 
+#if defined REMOVE_LIMITS
+	if (numvisplanes > maxsortedplanes)
+	{
+		if (sortedplanes)
+		{
+			Z_Free (sortedplanes);
+			Z_Free (planeflats);
+		}
+		maxsortedplanes = numvisplanes;
+		sortedplanes = Z_Malloc (maxsortedplanes * sizeof(*sortedplanes), PU_STATIC, NULL);
+		planeflats = Z_Malloc (maxsortedplanes * sizeof(*planeflats), PU_STATIC, NULL);
+	}
+#endif
+
+//
+// draw the sky and collect the flats
+//
+	numplanes = 0;
 	pl = drawvisplane;
 	while (pl != NULL)
 	{
@@ -509,35 +734,58 @@ void R_DrawPlanes (void)
 						colfunc ();
 					}
 				}
+#if defined LINEAR_FRAMEBUFFER
+				R_FlushColumns ();
+#endif
 			}
 			else
-			{
-				//
-				// regular flat
-				//
-				ds_source = W_CacheLumpNum(firstflat + flattranslation[pl->picnum], PU_STATIC);
-				planeheight = abs(pl->height-viewz);
-				light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
-				if (light >= LIGHTLEVELS)
-					light = LIGHTLEVELS-1;
-				if (light < 0)
-					light = 0;
-				planezlight = zlight[light];
-
-				pl->top[pl->maxx+1] = 0xff;
-				pl->top[pl->minx-1] = 0xff;
-
-				stop = pl->maxx + 1;
-				for (x=pl->minx ; x<= stop ; x++)
-					R_MakeSpans (x,pl->top[x-1],pl->bottom[x-1],pl->top[x],pl->bottom[x]);
-
-				Z_ChangeTag (ds_source, PU_CACHE);
-			}
+				sortedplanes[numplanes++] = pl;
 		}
 
 		prev = pl;
 		pl = pl->drawnext;
-		prev->picnum   = UNUSED_VISPLANE;
 		prev->drawnext = NULL;
+		if (prev->picnum == skyflatnum || prev->minx > prev->maxx)
+			prev->picnum = UNUSED_VISPLANE;
 	}
+
+//
+// map the flats, every flat is cached once
+//
+	qsort (sortedplanes, numplanes, sizeof(*sortedplanes), R_ComparePlanes);
+
+	numflats = 0;
+	for (i = 0; i < numplanes; i++)
+	{
+		pl = sortedplanes[i];
+		if (!i || flattranslation[pl->picnum] != flattranslation[sortedplanes[i-1]->picnum])
+		{
+			ds_source = W_CacheLumpNum(firstflat + flattranslation[pl->picnum], PU_STATIC);
+			planeflats[numflats++] = ds_source;
+		}
+		planeheight = abs(pl->height-viewz);
+		light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
+		if (light >= LIGHTLEVELS)
+			light = LIGHTLEVELS-1;
+		if (light < 0)
+			light = 0;
+		planezlight = zlight[light];
+
+		pl->top[pl->maxx+1] = NOPLANEROW;
+		pl->top[pl->minx-1] = NOPLANEROW;
+
+		stop = pl->maxx + 1;
+		for (x=pl->minx ; x<= stop ; x++)
+			R_MakeSpans (x,pl->top[x-1],pl->bottom[x-1],pl->top[x],pl->bottom[x]);
+
+		pl->picnum = UNUSED_VISPLANE;
+	}
+
+//
+// draw the spans a row at a time
+//
+	R_DrawPlaneSpans ();
+
+	for (i = 0; i < numflats; i++)
+		Z_ChangeTag (planeflats[i], PU_CACHE);
 }
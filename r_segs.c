@@ -151,7 +151,9 @@ void R_RenderMaskedSegRange (drawseg_t *ds, int32_t x1, int32_t x2)
 		}
 		spryscale += rw_scalestep;
 	}
-
+#if defined LINEAR_FRAMEBUFFER
+	R_FlushColumns ();
+#endif
 }
 
 /*
@@ -308,7 +310,9 @@ static void R_RenderSegLoop (void)
 		topfrac += topstep;
 		bottomfrac += bottomstep;
 	}
-
+#if defined LINEAR_FRAMEBUFFER
+	R_FlushColumns ();
+#endif
 }
 
 
@@ -331,8 +335,16 @@ void R_StoreWallRange (int32_t start, int32_t stop)
 	fixed_t         vtop;
 	int32_t         lightnum;
 
+#if defined REMOVE_LIMITS
+	R_CheckDrawSegs ();
+	R_CheckOpenings (3*(stop-start+1));	// masked texture and silhouettes
+#else
 	if (ds_p == &drawsegs[MAXDRAWSEGS])
+	{
+		M_PoolOverflow (pool_drawsegs);
 		return;         // don't overflow and crash
+	}
+#endif
 
 #ifdef RANGECHECK
 	if (start >=viewwidth || start > stop)
@@ -43,8 +43,8 @@ fixed_t		pspritescale, pspriteiscale;
 static lighttable_t	**spritelights;
 
 // constant arrays used for psprite clipping and initializing clipping
-int16_t	negonearray[SCREENWIDTH];
-int16_t	screenheightarray[SCREENWIDTH];
+int16_t	negonearray[MAXRENDERWIDTH];
+int16_t	screenheightarray[MAXRENDERWIDTH];
 
 /*
 ===============================================================================
@@ -61,6 +61,9 @@ static spriteframe_t	sprtemp[29];
 static int32_t			maxframe;
 static char				*spritename;
 
+#define SPRITEHASH		512		// > NUMSPRITES
+#define SPRITEHASHKEY(n)	(((uint32_t)(n) * 2654435761u >> 16) & (SPRITEHASH-1))
+
 
 
 /*
@@ -139,45 +142,70 @@ static void R_InitSpriteDefs (void)
 	int32_t		i, l, intname, frame, rotation;
 	int32_t		start, end;
 	int32_t		patched;
+	int16_t		namehash[SPRITEHASH];		// sprite number + 1, 0 if empty
+	int32_t		spritefirst[NUMSPRITES];
+	int32_t		*spritechain;				// the next lump of the same sprite
 
 	sprites = Z_Malloc(NUMSPRITES *sizeof(*sprites), PU_STATIC, NULL);
 
 	start = firstspritelump-1;
 	end = lastspritelump+1;
 
-// scan all the lump names for each of the names, noting the highest
-// frame letter
+// bucket the sprite lumps by their name in one pass,
+// each bucket is in lump order
 // Just compare 4 characters as ints
+	memset (namehash, 0, sizeof(namehash));
+	for (i=0 ; i<NUMSPRITES ; i++)
+	{
+		l = SPRITEHASHKEY(*(int32_t *)sprnames[i]);
+		while (namehash[l])
+			l = (l+1) & (SPRITEHASH-1);
+		namehash[l] = i+1;
+		spritefirst[i] = -1;
+	}
+
+	spritechain = Z_Malloc ((end-start)*sizeof(*spritechain), PU_STATIC, NULL);
+	for (l=end-1 ; l>start ; l--)
+	{
+		intname = *(int32_t *)lumpinfo[l].name;
+		for (i=SPRITEHASHKEY(intname) ; namehash[i] ; i=(i+1) & (SPRITEHASH-1))
+			if (*(int32_t *)sprnames[namehash[i]-1] == intname)
+			{
+				spritechain[l-start] = spritefirst[namehash[i]-1];
+				spritefirst[namehash[i]-1] = l;
+				break;
+			}
+	}
+
+// install the frames of each sprite, noting the highest frame letter
 	for (i=0 ; i<NUMSPRITES ; i++)
 	{
 		spritename = sprnames[i];
 		memset (sprtemp,-1, sizeof(sprtemp));
 
 		maxframe = -1;
-		intname = *(int32_t *)sprnames[i];
 
 		//
-		// scan the lumps, filling in the frames for whatever is found
+		// fill in the frames for whatever is found
 		//
-		for (l=start+1 ; l<end ; l++)
-			if (*(int32_t *)lumpinfo[l].name == intname)
-			{
-				frame = lumpinfo[l].name[4] - 'A';
-				rotation = lumpinfo[l].name[5] - '0';
+		for (l=spritefirst[i] ; l!=-1 ; l=spritechain[l-start])
+		{
+			frame = lumpinfo[l].name[4] - 'A';
+			rotation = lumpinfo[l].name[5] - '0';
 
-				if (modifiedgame)
-					patched = W_GetNumForName (lumpinfo[l].name);
-				else
-					patched = l;
-
-				R_InstallSpriteLump (patched, frame, rotation, false);
-				if (lumpinfo[l].name[6])
-				{
-					frame = lumpinfo[l].name[6] - 'A';
-					rotation = lumpinfo[l].name[7] - '0';
-					R_InstallSpriteLump (l, frame, rotation, true);
-				}
+			if (modifiedgame)
+				patched = W_GetNumForName (lumpinfo[l].name);
+			else
+				patched = l;
+
+			R_InstallSpriteLump (patched, frame, rotation, false);
+			if (lumpinfo[l].name[6])
+			{
+				frame = lumpinfo[l].name[6] - 'A';
+				rotation = lumpinfo[l].name[7] - '0';
+				R_InstallSpriteLump (l, frame, rotation, true);
 			}
+		}
 
 		//
 		// check the frames that were found for completeness
@@ -216,6 +244,7 @@ static void R_InitSpriteDefs (void)
 		memcpy (sprites[i].spriteframes, sprtemp, maxframe*sizeof(spriteframe_t));
 	}
 
+	Z_Free (spritechain);
 }
 
 
@@ -229,8 +258,14 @@ static void R_InitSpriteDefs (void)
 #define	MAXVISSPRITES	128
 
 static int32_t		num_vissprite;
+#if defined REMOVE_LIMITS
+static int32_t		maxvissprites;
+static vissprite_t	*vissprites;
+static vissprite_t	**vissprite_ptrs;	// second half is scratch space for msort
+#else
 static vissprite_t	vissprites[MAXVISSPRITES];
-static vissprite_t*	vissprite_ptrs[MAXVISSPRITES];
+static vissprite_t*	vissprite_ptrs[MAXVISSPRITES * 2];	// second half is scratch space for msort
+#endif
 
 
 /*
@@ -246,7 +281,7 @@ void R_InitSprites (void)
 {
 	int32_t		i;
 
-	for (i=0 ; i<SCREENWIDTH ; i++)
+	for (i=0 ; i<MAXRENDERWIDTH ; i++)
 	{
 		negonearray[i] = -1;
 	}
@@ -278,15 +313,36 @@ void R_ClearSprites (void)
 ===================
 */
 
+#if defined REMOVE_LIMITS
+static vissprite_t *R_NewVisSprite (void)
+{
+	if (num_vissprite == maxvissprites)
+	{	// the vissprites keep their size for the next frames
+		if (maxvissprites)
+			M_PoolOverflow (pool_vissprites);
+		maxvissprites = maxvissprites ? maxvissprites * 2 : MAXVISSPRITES;
+		vissprites = realloc (vissprites, maxvissprites * sizeof(*vissprites));
+		vissprite_ptrs = realloc (vissprite_ptrs, maxvissprites * 2 * sizeof(*vissprite_ptrs));
+		if (!vissprites || !vissprite_ptrs)
+			I_Error ("R_NewVisSprite: couldn't allocate %i vissprites", maxvissprites);
+	}
+
+	return vissprites + num_vissprite++;
+}
+#else
 static vissprite_t		overflowsprite;
 
 static vissprite_t *R_NewVisSprite (void)
 {
 	if (num_vissprite >= MAXVISSPRITES)
+	{
+		M_PoolOverflow (pool_vissprites);
 		return &overflowsprite;
+	}
 
 	return vissprites + num_vissprite++;
 }
+#endif
 
 
 /*
@@ -362,7 +418,7 @@ static void R_DrawVisSprite (vissprite_t *vis)
 		colfunc = fuzzcolfunc;		// NULL colormap = shadow draw
 	else if (vis->mobjflags & MF_TRANSLATION)
 	{
-		colfunc = R_DrawTranslatedColumn;
+		colfunc = transcolfunc;
 		dc_translation = translationtables - 256 +
 			( (vis->mobjflags & MF_TRANSLATION) >> (MF_TRANSSHIFT-8) );
 	}
@@ -385,6 +441,9 @@ static void R_DrawVisSprite (vissprite_t *vis)
 		 LONG(patch->columnofs[texturecolumn]));
 		 R_DrawMaskedColumn (column);
 	}
+#if defined LINEAR_FRAMEBUFFER
+	R_FlushColumns ();
+#endif
 
 	colfunc = basecolfunc;
 }
@@ -739,6 +798,8 @@ static void R_SortVisSprites (void)
 {
 	int32_t i = num_vissprite;
 
+	M_PoolUsage (pool_vissprites, num_vissprite);
+
 	if (i)
 	{
 		while (--i >= 0)
@@ -761,7 +822,7 @@ static void R_SortVisSprites (void)
 static void R_DrawSprite (vissprite_t *spr)
 {
 	drawseg_t		*ds;
-	int16_t			clipbot[SCREENWIDTH], cliptop[SCREENWIDTH];
+	int16_t			clipbot[MAXRENDERWIDTH], cliptop[MAXRENDERWIDTH];
 	int32_t			x, r1, r2;
 	fixed_t			scale, lowscale;
 	int32_t			silhouette;
@@ -18,8 +18,10 @@
 
 // V_video.c
 
+#if !defined __linux__
 #include <conio.h>
 #include <dos.h>
+#endif
 #include "doomdef.h"
 
 //
@@ -32,6 +34,9 @@
 
 byte		*screens[5];
 int32_t		dirtybox[4];
+#if defined RENDER_RESOLUTION
+int16_t		dirtyleft[SCREENHEIGHT], dirtyright[SCREENHEIGHT];	// the columns drawn on per row
+#endif
 
 
 
@@ -62,9 +67,49 @@ int32_t			usegamma;
 
 void V_MarkRect (int32_t x, int32_t y, int32_t width, int32_t height)
 { 
+#if defined RENDER_RESOLUTION
+	int32_t		row, bottom;
+#endif
+
 	M_AddToBox (dirtybox, x, y);
 	M_AddToBox (dirtybox, x+width-1, y+height-1);
+
+#if defined RENDER_RESOLUTION
+	row = y < 0 ? 0 : y;
+	bottom = y+height > SCREENHEIGHT ? SCREENHEIGHT : y+height;
+	for ( ; row < bottom; row++)
+	{
+		if (dirtyleft[row] > x)
+			dirtyleft[row] = x;
+		if (dirtyright[row] < x+width-1)
+			dirtyright[row] = x+width-1;
+	}
+#endif
 }
+
+#if defined RENDER_RESOLUTION
+/*
+==================
+=
+= V_ClearDirtyRows
+=
+= Called when the view is rendered, so the rows only hold what
+= the 2D layers draw on top of it
+=
+==================
+*/
+
+void V_ClearDirtyRows (void)
+{
+	int32_t		y;
+
+	for (y = 0; y < SCREENHEIGHT; y++)
+	{
+		dirtyleft[y] = SCREENWIDTH;
+		dirtyright[y] = -1;
+	}
+}
+#endif
  
 
 /*
@@ -208,6 +253,12 @@ void V_DrawPatchFlipped (int32_t x, int32_t y, int32_t scrn, patch_t *patch)
 ==================
 */
 
+#if defined LINEAR_FRAMEBUFFER
+void V_DrawPatchDirect (int32_t x, int32_t y, patch_t *patch)
+{
+	V_DrawPatch (x, y, 0, patch);
+}
+#else
 void V_DrawPatchDirect (int32_t x, int32_t y, patch_t *patch)
 {
 	int32_t		count,col;
@@ -251,6 +302,7 @@ void V_DrawPatchDirect (int32_t x, int32_t y, patch_t *patch)
 			desttop++;	// go to next byte, not next plane
 	}
 }
+#endif
 
 /*
 ==================
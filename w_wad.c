@@ -19,11 +19,16 @@
 // W_wad.c
 
 #include <ctype.h>
+#if !defined __linux__
 #include <io.h>
+#endif
 #include <unistd.h>
 #include <fcntl.h>
 
 #include "doomdef.h"
+#if defined MMAP_WADS
+#include <sys/mman.h>
+#endif
 
 
 //===============
@@ -46,16 +51,43 @@ typedef struct
 	char		name[8];
 } filelump_t;
 
+// A lump with this bit set in filepos is stored as an LZ4 block,
+// size is the uncompressed size
+#define LUMPCOMPRESSED	0x80000000
+
 
 //=============
 // GLOBALS
 //=============
 
 lumpinfo_t	*lumpinfo;		// location of each lump on disk
-static int32_t			numlumps;
+int32_t					numlumps;
 
 static void		**lumpcache;
 
+#if defined MMAP_WADS
+// The files are mapped copy-on-write, so a lump that is changed in place
+// gets private pages and the file stays untouched
+static byte		**lumpdata;		// NULL if the lump isn't mapped
+#endif
+
+// lumps with the same name hash are chained, the last lump first,
+// so a later file still overrides an earlier one
+static int32_t	*lumphash;
+static int32_t	*lumpchain;
+static int32_t	lumphashmask;
+
+// cache statistics, a read of a lump that was read before
+// means it was purged in between
+static lumpstats_t	*lumpstats;
+static byte			*lumpcategory;
+lumpstats_t			lumpcategorystats[NUMLUMPCATEGORIES];
+
+char *const lumpcategorynames[NUMLUMPCATEGORIES] =
+{
+	"other", "map", "flat", "patch", "sprite", "sound", "music"
+};
+
 
 //===================
 
@@ -116,11 +148,15 @@ static void W_AddFile (char *filename)
 {
 	wadinfo_t		header;
 	lumpinfo_t		*lump_p;
-	uint32_t		i;
+	int32_t			i;
 	int32_t			handle, length;
 	int32_t			startlump;
 	filelump_t		*fileinfo, singleinfo;
 	int32_t			storehandle;
+#if defined MMAP_WADS
+	byte			*mapping;
+	int32_t			filesize;
+#endif
 	
 //
 // open the file and add to directory
@@ -180,10 +216,31 @@ static void W_AddFile (char *filename)
 	for (i=startlump ; i<numlumps ; i++,lump_p++, fileinfo++)
 	{
 		lump_p->handle = storehandle;
-		lump_p->position = LONG(fileinfo->filepos);
+		lump_p->position = LONG(fileinfo->filepos) & ~LUMPCOMPRESSED;
+		lump_p->compressed = (LONG(fileinfo->filepos) & LUMPCOMPRESSED) != 0;
 		lump_p->size = LONG(fileinfo->size);
 		strncpy (lump_p->name, fileinfo->name, 8);
 	}
+
+#if defined MMAP_WADS
+	lumpdata = realloc (lumpdata, numlumps*sizeof(*lumpdata));
+	if (!lumpdata)
+		I_Error ("Couldn't realloc lumpdata");
+
+	mapping = MAP_FAILED;
+	filesize = filelength (handle);
+	if (storehandle != -1 && filesize > 0)
+		mapping = mmap (NULL, filesize, PROT_READ | PROT_WRITE, MAP_PRIVATE, handle, 0);
+
+	for (i=startlump, lump_p=&lumpinfo[startlump] ; i<numlumps ; i++,lump_p++)
+	{
+		if (mapping != MAP_FAILED && !lump_p->compressed
+		&& lump_p->position + lump_p->size <= filesize)
+			lumpdata[i] = mapping + lump_p->position;
+		else
+			lumpdata[i] = NULL;
+	}
+#endif
 	if (reloadname)
 		close (handle);
 }
@@ -206,7 +263,7 @@ void W_Reload (void)
 	wadinfo_t		header;
 	int32_t			lumpcount;
 	lumpinfo_t		*lump_p;
-	uint32_t		i;
+	int32_t			i;
 	int32_t			handle;
 	int32_t			length;
 	filelump_t		*fileinfo;
@@ -235,7 +292,8 @@ void W_Reload (void)
 		if (lumpcache[i])
 			Z_Free (lumpcache[i]);
 
-		lump_p->position = LONG(fileinfo->filepos);
+		lump_p->position = LONG(fileinfo->filepos) & ~LUMPCOMPRESSED;
+		lump_p->compressed = (LONG(fileinfo->filepos) & LUMPCOMPRESSED) != 0;
 		lump_p->size = LONG(fileinfo->size);
 	}
 	
@@ -244,6 +302,99 @@ void W_Reload (void)
 
 
 
+/*
+====================
+=
+= W_HashLumps
+=
+====================
+*/
+
+static uint32_t W_HashName (int64_t v)
+{
+	return ((uint32_t)v ^ (uint32_t)(v >> 32)) * 2654435761u >> 16;
+}
+
+static void W_HashLumps (void)
+{
+	int32_t		i, buckets;
+	uint32_t	h;
+
+	for (buckets = 256; buckets < numlumps; buckets <<= 1)
+		;
+	lumphashmask = buckets - 1;
+
+	lumphash = malloc (buckets * sizeof(*lumphash));
+	lumpchain = malloc (numlumps * sizeof(*lumpchain));
+	if (!lumphash || !lumpchain)
+		I_Error ("Couldn't allocate the lump hash");
+	memset (lumphash, -1, buckets * sizeof(*lumphash));
+
+	for (i = 0; i < numlumps; i++)
+	{
+		h = W_HashName (*(int64_t *)lumpinfo[i].name) & lumphashmask;
+		lumpchain[i] = lumphash[h];
+		lumphash[h] = i;
+	}
+}
+
+
+
+/*
+====================
+=
+= W_CategorizeLumps
+=
+====================
+*/
+
+// every wad file can have its own start and end markers, so all pairs count
+
+static void W_MarkLumps (char *start, char *end, lumpcategory_t category)
+{
+	int32_t		i;
+	boolean		inside;
+
+	inside = false;
+	for (i=0 ; i<numlumps ; i++)
+	{
+		if (!strncmp (lumpinfo[i].name, start, 8))
+			inside = true;
+		else if (!strncmp (lumpinfo[i].name, end, 8))
+			inside = false;
+		else if (inside)
+			lumpcategory[i] = category;
+	}
+}
+
+static void W_CategorizeLumps (void)
+{
+	int32_t		i, j;
+
+	lumpstats = malloc (numlumps*sizeof(*lumpstats));
+	lumpcategory = malloc (numlumps);
+	if (!lumpstats || !lumpcategory)
+		I_Error ("Couldn't allocate the lump statistics");
+	memset (lumpstats, 0, numlumps*sizeof(*lumpstats));
+	memset (lumpcategory, lc_other, numlumps);
+
+	for (i=0 ; i<numlumps ; i++)
+	{
+		if (!strncmp (lumpinfo[i].name, "D_", 2))
+			lumpcategory[i] = lc_music;
+		else if (!strncmp (lumpinfo[i].name, "DS", 2) || !strncmp (lumpinfo[i].name, "DP", 2))
+			lumpcategory[i] = lc_sound;
+		else if (!strncmp (lumpinfo[i].name, "THINGS", 8) && i >= ML_THINGS)
+			for (j=i-ML_THINGS ; j<=i-ML_THINGS+ML_BLOCKMAP && j<numlumps ; j++)
+				lumpcategory[j] = lc_map;
+	}
+
+	W_MarkLumps ("F_START", "F_END", lc_flat);
+	W_MarkLumps ("P_START", "P_END", lc_patch);
+	W_MarkLumps ("S_START", "S_END", lc_sprite);
+}
+
+
 /*
 ====================
 =
@@ -287,6 +438,10 @@ void W_InitMultipleFiles (char **filenames)
 	if (!lumpcache)
 		I_Error ("Couldn't allocate lumpcache");
 	memset (lumpcache,0, size);
+
+	W_HashLumps ();
+
+	W_CategorizeLumps ();
 }
 
 
@@ -305,7 +460,7 @@ int32_t	W_CheckNumForName (char *name)
 {
 	char	name8[9];
 	int64_t		v;
-	lumpinfo_t	*lump_p;
+	int32_t		i;
 
 // make the name into two integers for easy compares
 
@@ -316,13 +471,11 @@ int32_t	W_CheckNumForName (char *name)
 	v = *(int64_t *)name8;
 
 
-// scan backwards so patch lump files take precedence
-
-	lump_p = lumpinfo + numlumps;
+// the chain starts with the last lump, so patch lump files take precedence
 
-	while (lump_p-- != lumpinfo)
-		if ( *(int64_t *)lump_p->name == v)
-			return lump_p - lumpinfo;
+	for (i = lumphash[W_HashName (v) & lumphashmask]; i != -1; i = lumpchain[i])
+		if ( *(int64_t *)lumpinfo[i].name == v)
+			return i;
 
 
 	return -1;
@@ -369,6 +522,134 @@ int32_t W_LumpLength (int32_t lump)
 }
 
 
+/*
+====================
+=
+= W_CountLump
+=
+====================
+*/
+
+static void W_CountLump (int32_t lump, boolean read)
+{
+	lumpstats_t	*s, *c;
+
+	s = &lumpstats[lump];
+	c = &lumpcategorystats[lumpcategory[lump]];
+	if (!read)
+	{
+		s->hits++;
+		c->hits++;
+		return;
+	}
+
+	if (s->misses)
+	{
+		s->rereads++;
+		c->rereads++;
+	}
+	s->misses++;
+	c->misses++;
+	s->bytes += lumpinfo[lump].size;
+	c->bytes += lumpinfo[lump].size;
+}
+
+
+/*
+====================
+=
+= W_Decompress
+=
+= Decodes an LZ4 block while it is read, the input is read in small pieces
+= and the matches are copied from the output
+=
+====================
+*/
+
+#define DECOMPRESSBUFFER	0x1000
+
+static byte		decompressbuffer[DECOMPRESSBUFFER];
+static byte		*decompress_p, *decompressend;
+static int32_t	decompresshandle;
+static int32_t	decompresslump;
+
+static int32_t W_DecompressByte (void)
+{
+	int32_t		c;
+
+	if (decompress_p == decompressend)
+	{
+		c = read (decompresshandle, decompressbuffer, DECOMPRESSBUFFER);
+		if (c <= 0)
+			I_Error ("W_Decompress: lump %i is truncated",decompresslump);
+		decompress_p = decompressbuffer;
+		decompressend = decompressbuffer + c;
+	}
+	return *decompress_p++;
+}
+
+static int32_t W_DecompressLength (int32_t length)
+{
+	int32_t		c;
+
+	if (length == 15)
+		do
+		{
+			c = W_DecompressByte ();
+			length += c;
+		} while (c == 255);
+	return length;
+}
+
+static void W_Decompress (int32_t handle, byte *dest, int32_t size, int32_t lump)
+{
+	byte		*out, *end, *match;
+	int32_t		token, length, c;
+
+	decompresshandle = handle;
+	decompresslump = lump;
+	decompress_p = decompressend = decompressbuffer;
+
+	out = dest;
+	end = dest + size;
+	while (out < end)
+	{
+		token = W_DecompressByte ();
+
+	// literals, straight from the input buffer
+		length = W_DecompressLength (token >> 4);
+		if (length > end - out)
+			I_Error ("W_Decompress: lump %i is corrupt",lump);
+		while (length)
+		{
+			if (decompress_p == decompressend)
+			{
+				*out++ = W_DecompressByte ();
+				length--;
+			}
+			c = decompressend - decompress_p;
+			if (c > length)
+				c = length;
+			memcpy (out, decompress_p, c);
+			decompress_p += c;
+			out += c;
+			length -= c;
+		}
+		if (out == end)
+			break;			// the last sequence has no match
+
+	// match, can overlap the output
+		c = W_DecompressByte ();
+		match = out - (c | W_DecompressByte () << 8);
+		length = W_DecompressLength (token & 15) + 4;
+		if (match < dest || match == out || length > end - out)
+			I_Error ("W_Decompress: lump %i is corrupt",lump);
+		while (length--)
+			*out++ = *match++;
+	}
+}
+
+
 /*
 ====================
 =
@@ -388,6 +669,24 @@ void W_ReadLump (int32_t lump, void *dest)
 	if (lump >= numlumps)
 		I_Error ("W_ReadLump: %i >= numlumps",lump);
 	l = lumpinfo+lump;
+
+#if defined MMAP_WADS
+	if (lumpdata[lump])
+	{
+		W_CountLump (lump, !lumpstats[lump].misses);
+		memcpy (dest, lumpdata[lump], l->size);
+		return;
+	}
+#endif
+
+	if (lumpcache[lump] && lumpcache[lump] != dest)
+	{	// already cached, by W_CacheLumpBatch for instance
+		W_CountLump (lump, false);
+		memcpy (dest, lumpcache[lump], l->size);
+		return;
+	}
+
+	W_CountLump (lump, true);
 	
 	I_BeginRead ();
 	if (l->handle == -1)
@@ -398,9 +697,14 @@ void W_ReadLump (int32_t lump, void *dest)
 	else
 		handle = l->handle;
 	lseek (handle, l->position, SEEK_SET);
-	c = read (handle, dest, l->size);
-	if (c < l->size)
-		I_Error ("W_ReadLump: only read %i of %i on lump %i",c,l->size,lump);	
+	if (l->compressed)
+		W_Decompress (handle, dest, l->size, lump);
+	else
+	{
+		c = read (handle, dest, l->size);
+		if (c < l->size)
+			I_Error ("W_ReadLump: only read %i of %i on lump %i",c,l->size,lump);	
+	}
 	if (l->handle == -1)
 		close (handle);
 	I_EndRead ();
@@ -419,18 +723,25 @@ void W_ReadLump (int32_t lump, void *dest)
 void	*W_CacheLumpNum (int32_t lump, int32_t tag)
 {
 
-	if ((uint32_t)lump >= numlumps)
+	if (lump < 0 || lump >= numlumps)
 		I_Error ("W_CacheLumpNum: %i >= numlumps",lump);
+
+#if defined MMAP_WADS
+	if (lumpdata[lump])
+	{	// the first use reads the pages in
+		W_CountLump (lump, !lumpstats[lump].misses);
+		return lumpdata[lump];
+	}
+#endif
 		
 	if (!lumpcache[lump])
 	{	// read the lump in
-//printf ("cache miss on lump %i\n",lump);
 		Z_Malloc (W_LumpLength (lump), tag, &lumpcache[lump]);
 		W_ReadLump (lump, lumpcache[lump]);
 	}
 	else
 	{
-//printf ("cache hit on lump %i\n",lump);
+		W_CountLump (lump, false);
 		Z_ChangeTag (lumpcache[lump],tag);
 	}
 	
@@ -450,3 +761,243 @@ void	*W_CacheLumpName (char *name, int32_t tag)
 {
 	return W_CacheLumpNum (W_GetNumForName(name), tag);
 }
+
+
+/*
+====================
+=
+= W_CacheLumpBatch
+=
+= Caches a list of lumps, lumps that follow each other in a file
+= are read with a single read
+= The list is sorted by file position
+=
+====================
+*/
+
+#define BATCHBUFFER	0x10000
+
+static byte		batchbuffer[BATCHBUFFER];
+
+static int W_ComparePosition (const void *a, const void *b)
+{
+	lumpinfo_t	*la = &lumpinfo[*(const int32_t *)a];
+	lumpinfo_t	*lb = &lumpinfo[*(const int32_t *)b];
+
+	if (la->handle != lb->handle)
+		return la->handle < lb->handle ? -1 : 1;
+	return la->position < lb->position ? -1 : la->position > lb->position;
+}
+
+static boolean W_BatchRead (int32_t lump)
+{
+	if (lumpcache[lump] || lumpinfo[lump].handle == -1 || lumpinfo[lump].compressed)
+		return false;
+#if defined MMAP_WADS
+	if (lumpdata[lump])
+		return false;
+#endif
+	return lumpinfo[lump].size <= BATCHBUFFER;
+}
+
+void W_CacheLumpBatch (int32_t *lumps, int32_t count, int32_t tag)
+{
+	int32_t		i, j, k, c;
+	int32_t		start, end;
+	lumpinfo_t	*l;
+
+	for (i=0 ; i<count ; i++)
+		if (lumps[i] < 0 || lumps[i] >= numlumps)
+			I_Error ("W_CacheLumpBatch: %i >= numlumps",lumps[i]);
+
+	qsort (lumps, count, sizeof(*lumps), W_ComparePosition);
+
+	for (i=0 ; i<count ; i=j)
+	{
+		j = i+1;
+		if (!W_BatchRead (lumps[i]))
+		{
+			W_CacheLumpNum (lumps[i], tag);
+			continue;
+		}
+
+	// find the lumps that follow in the file
+		l = &lumpinfo[lumps[i]];
+		start = l->position;
+		end = start + l->size;
+		for ( ; j<count ; j++)
+		{
+			l = &lumpinfo[lumps[j]];
+			if (l->handle != lumpinfo[lumps[i]].handle || l->compressed || l->position > end
+			|| l->position + l->size - start > BATCHBUFFER)
+				break;
+#if defined MMAP_WADS
+			if (lumpdata[lumps[j]])
+				break;		// mapped lumps don't get zone copies
+#endif
+			if (end < l->position + l->size)
+				end = l->position + l->size;
+		}
+
+		if (j == i+1)
+		{
+			W_CacheLumpNum (lumps[i], tag);
+			continue;
+		}
+
+		I_BeginRead ();
+		lseek (lumpinfo[lumps[i]].handle, start, SEEK_SET);
+		c = read (lumpinfo[lumps[i]].handle, batchbuffer, end - start);
+		if (c < end - start)
+			I_Error ("W_CacheLumpBatch: only read %i of %i on lump %i",c,end - start,lumps[i]);
+		I_EndRead ();
+
+	// the lumps of the range that are cached already are made static,
+	// so allocating the others can't purge them
+		for (k=i ; k<j ; k++)
+			if (lumpcache[lumps[k]])
+			{
+				W_CountLump (lumps[k], false);
+				Z_ChangeTag (lumpcache[lumps[k]], PU_STATIC);
+			}
+
+	// split the read into cache blocks, static until all are allocated
+		for (k=i ; k<j ; k++)
+		{
+			l = &lumpinfo[lumps[k]];
+			if (!lumpcache[lumps[k]])
+			{
+				W_CountLump (lumps[k], true);
+				Z_Malloc (l->size, PU_STATIC, &lumpcache[lumps[k]]);
+				memcpy (lumpcache[lumps[k]], batchbuffer + l->position - start, l->size);
+			}
+		}
+		for (k=i ; k<j ; k++)
+			Z_ChangeTag (lumpcache[lumps[k]], tag);
+	}
+}
+
+
+/*
+============================================================================
+
+						LUMP PREFETCHING
+
+The lumps of the next level are queued during the intermission and read a
+few at a time every tic, so the level loads from the cache.
+On a mapped WAD file the kernel is asked to read the pages in the background.
+
+============================================================================
+*/
+
+#define MAXPREFETCH		2048
+#define PREFETCHBYTES	0x10000		// read per tic
+
+static int32_t	prefetchqueue[MAXPREFETCH];
+static int32_t	prefetchhead, prefetchtail;
+
+
+void W_PrefetchLump (int32_t lump)
+{
+	if (lump < 0 || lump >= numlumps || prefetchtail == MAXPREFETCH)
+		return;
+
+	prefetchqueue[prefetchtail++] = lump;
+}
+
+
+void W_PrefetchTic (void)
+{
+	int32_t		lump;
+	int32_t		bytes;
+#if defined MMAP_WADS
+	uintptr_t	start;
+#endif
+
+	bytes = 0;
+	while (prefetchhead < prefetchtail && bytes < PREFETCHBYTES)
+	{
+		lump = prefetchqueue[prefetchhead++];
+
+#if defined MMAP_WADS
+		if (lumpdata[lump])
+		{
+			start = (uintptr_t)lumpdata[lump] & ~(uintptr_t)0xfff;
+			madvise ((void *)start, (uintptr_t)lumpdata[lump] + lumpinfo[lump].size - start, MADV_WILLNEED);
+			continue;
+		}
+#endif
+
+		if (lumpcache[lump])
+			continue;
+		Z_Malloc (lumpinfo[lump].size, PU_CACHE, &lumpcache[lump]);
+		W_ReadLump (lump, lumpcache[lump]);
+		bytes += lumpinfo[lump].size;
+	}
+
+	if (prefetchhead == prefetchtail)
+		prefetchhead = prefetchtail = 0;
+}
+
+
+void W_ClearPrefetch (void)
+{
+	prefetchhead = prefetchtail = 0;
+}
+
+
+/*
+====================
+=
+= W_PrintLumpStats
+=
+= Called on exit with -lumpstats
+=
+====================
+*/
+
+#define WORSTLUMPS	10
+
+void W_PrintLumpStats (void)
+{
+	int32_t		i, j, k;
+	int32_t		worst[WORSTLUMPS];
+	lumpstats_t	*c;
+
+	printf ("\nLump cache     hits   misses  rereads    kB read\n");
+	for (i=0 ; i<NUMLUMPCATEGORIES ; i++)
+	{
+		c = &lumpcategorystats[i];
+		printf ("%-8s %10i %8i %8i %10u\n", lumpcategorynames[i],
+			c->hits, c->misses, c->rereads, c->bytes / 1024);
+	}
+
+	// the lumps that were read again most often
+	for (i=0 ; i<WORSTLUMPS ; i++)
+	{
+		worst[i] = -1;
+		for (j=0 ; j<numlumps ; j++)
+		{
+			if (!lumpstats[j].rereads || (worst[i] != -1
+			&& lumpstats[j].rereads * lumpinfo[j].size <= lumpstats[worst[i]].rereads * lumpinfo[worst[i]].size))
+				continue;
+			for (k=0 ; k<i ; k++)
+				if (worst[k] == j)
+					break;
+			if (k == i)
+				worst[i] = j;
+		}
+		if (worst[i] == -1)
+			break;
+	}
+
+	if (i)
+		printf ("\nMost bytes read again\n");
+	for (j=0 ; j<i ; j++)
+	{
+		k = worst[j];
+		printf ("%-8.8s %-8s %6i rereads %8i bytes\n", lumpinfo[k].name,
+			lumpcategorynames[lumpcategory[k]], lumpstats[k].rereads,
+			lumpstats[k].rereads * lumpinfo[k].size);
+	}
+}
@@ -28,27 +28,129 @@
 There is never any space between memblocks, and there will never be two
 contiguous free memblocks.
 
-The rover can be left pointing at a non-empty block
-
 It is of no value to free a cachable block, because it will get overwritten
 automatically if needed
 
+Every free block is also on the free list of its size class, the links are
+kept in the unused data of the block. Z_Malloc takes the first fitting free
+block of the size class, looking at a few blocks at most, or the first block
+of a larger class, and only purges cachable blocks when there is none.
+
+The purgable blocks are on a list, the least recently used first. A block
+goes to the end when it's allocated or its tag is changed, which
+W_CacheLumpNum does on every hit, and by Z_Touch for blocks that are used
+without a tag change, like the texture composites. Z_Malloc purges the
+least recently used block together with the free and purgable blocks
+around it, so the lumps in use survive.
+
 ==============================================================================
 */
 
 #define	ZONEID	0x1d4a11
 
+// block sizes are rounded up to this, so every block is pointer aligned
+#define	ZONEALIGN	((int32_t)sizeof(void *))
+#define	ZONEROUND(size)	(((size) + ZONEALIGN - 1) & ~(ZONEALIGN - 1))
+
+#define	NUMBINS		16
+#define	MINBINSHIFT	5			// the first bin holds blocks up to 63 bytes
+#define	MAXBINWALK	8			// blocks looked at in the size class of a request
+
+typedef struct
+{
+	memblock_t	*next, *prev;
+} freelinks_t;
+
+#define FREELINKS(block)	((freelinks_t *)((byte *)(block) + sizeof(memblock_t)))
+
 typedef struct
 {
 	int32_t		size;		// total bytes malloced, including header
 	memblock_t	blocklist;		// start / end cap for linked list
-	memblock_t	*rover;
+	memblock_t	*freebins[NUMBINS];	// free blocks by size class
+	memblock_t	cachelist;		// start / end cap for the purgable blocks
 } memzone_t;
 
 
 
 static memzone_t *mainzone;
 
+typedef struct
+{
+	uint32_t	mallocs, frees;
+	uint32_t	purges, purgedbytes;	// cachable blocks thrown out by Z_Malloc
+	uint32_t	walked, maxwalk;		// blocks looked at by Z_Malloc
+	int32_t		tagbytes[PU_CACHE + 1];
+} zonestats_t;
+
+static zonestats_t zonestats;
+
+/*
+========================
+=
+= Z_SizeBin
+=
+= Blocks in bin n are at least 2^(n+MINBINSHIFT) bytes,
+= except for the first bin
+=
+========================
+*/
+
+static int32_t Z_SizeBin (int32_t size)
+{
+	int32_t	bin;
+
+	bin = 0;
+	size >>= MINBINSHIFT;
+	while (size > 1 && bin < NUMBINS - 1)
+	{
+		size >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+static void Z_LinkFree (memblock_t *block)
+{
+	memblock_t	**bin;
+
+	bin = &mainzone->freebins[Z_SizeBin (block->size)];
+	FREELINKS(block)->prev = NULL;
+	FREELINKS(block)->next = *bin;
+	if (*bin)
+		FREELINKS(*bin)->prev = block;
+	*bin = block;
+}
+
+static void Z_UnlinkFree (memblock_t *block)
+{
+	freelinks_t	*links;
+
+	links = FREELINKS(block);
+	if (links->prev)
+		FREELINKS(links->prev)->next = links->next;
+	else
+		mainzone->freebins[Z_SizeBin (block->size)] = links->next;
+	if (links->next)
+		FREELINKS(links->next)->prev = links->prev;
+}
+
+// purgable blocks are put at the end of the cache list when they're used
+
+static void Z_LinkCache (memblock_t *block)
+{
+	block->lruprev = mainzone->cachelist.lruprev;
+	block->lrunext = &mainzone->cachelist;
+	block->lruprev->lrunext = block;
+	mainzone->cachelist.lruprev = block;
+}
+
+static void Z_UnlinkCache (memblock_t *block)
+{
+	block->lruprev->lrunext = block->lrunext;
+	block->lrunext->lruprev = block->lruprev;
+}
+
 /*
 ========================
 =
@@ -71,11 +173,11 @@ void Z_Init (void)
 		(memblock_t *)( (byte *)mainzone + sizeof(memzone_t) );
 	mainzone->blocklist.user = (void *)mainzone;
 	mainzone->blocklist.tag = PU_STATIC;
-	mainzone->rover = block;
-	
+	mainzone->cachelist.lrunext = mainzone->cachelist.lruprev = &mainzone->cachelist;
 	block->prev = block->next = &mainzone->blocklist;
 	block->user = NULL;	// free block
 	block->size = mainzone->size - sizeof(memzone_t);
+	Z_LinkFree (block);
 }
 
 
@@ -87,14 +189,31 @@ void Z_Init (void)
 ========================
 */
 
+#if defined MMAP_WADS
+boolean Z_IsZoneMemory (void *ptr)
+{
+	return (byte *)ptr > (byte *)mainzone && (byte *)ptr < (byte *)mainzone + mainzone->size;
+}
+#endif
+
 void Z_Free (void *ptr)
 {
 	memblock_t	*block, *other;
 	
+#if defined MMAP_WADS
+	if (!Z_IsZoneMemory (ptr))
+		return;		// a lump in a mapped WAD file
+#endif
+
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID)
 		I_Error ("Z_Free: freed a pointer without ZONEID");
 		
+	zonestats.frees++;
+	zonestats.tagbytes[block->tag] -= block->size;
+	if (block->tag >= PU_PURGELEVEL)
+		Z_UnlinkCache (block);
+
 	if (block->user > (void **)0x100)	// smaller values are not pointers
 		*block->user = 0;		// clear the user's mark
 	block->user = NULL;	// mark as free
@@ -104,23 +223,23 @@ void Z_Free (void *ptr)
 	other = block->prev;
 	if (!other->user)
 	{	// merge with previous free block
+		Z_UnlinkFree (other);
 		other->size += block->size;
 		other->next = block->next;
 		other->next->prev = other;
-		if (block == mainzone->rover)
-			mainzone->rover = other;
 		block = other;
 	}
 	
 	other = block->next;
 	if (!other->user)
 	{	// merge the next free block onto the end
+		Z_UnlinkFree (other);
 		block->size += other->size;
 		block->next = other->next;
 		block->next->prev = block;
-		if (other == mainzone->rover)
-			mainzone->rover = block;
 	}
+
+	Z_LinkFree (block);
 }
 
 
@@ -135,54 +254,116 @@ void Z_Free (void *ptr)
 
 #define MINFRAGMENT	64
 
+static void	(*purgehook) (void);
+
+void Z_SetPurgeHook (void (*hook) (void))
+{
+	purgehook = hook;
+}
+
+#define Z_Purgable(block)	(!(block)->user || (block)->tag >= PU_PURGELEVEL)
+
+static void Z_Purge (memblock_t *block)
+{
+	zonestats.purges++;
+	zonestats.purgedbytes += block->size;
+	Z_Free ((byte *)block+sizeof(memblock_t));
+}
+
+// returns the first block of a run of free and purgable blocks that is big
+// enough, around the least recently used block. The least recently used
+// blocks that can't be part of one are thrown out.
+
+static memblock_t *Z_FindPurgeRun (int32_t size, uint32_t *walk)
+{
+	memblock_t	*oldest, *first, *last;
+	int32_t		runsize;
+
+	while ((oldest = mainzone->cachelist.lrunext) != &mainzone->cachelist)
+	{
+		(*walk)++;
+		first = last = oldest;
+		runsize = oldest->size;
+		while (runsize < size && Z_Purgable (last->next))
+		{
+			(*walk)++;
+			last = last->next;
+			runsize += last->size;
+		}
+		while (runsize < size && Z_Purgable (first->prev))
+		{
+			(*walk)++;
+			first = first->prev;
+			runsize += first->size;
+		}
+		if (runsize >= size)
+			return first;
+
+		Z_Purge (oldest);
+	}
+
+	return NULL;
+}
+
 void *Z_Malloc (int32_t size, int32_t tag, void *user)
 {
 	int32_t		extra;
-	memblock_t	*start, *rover, *new, *base;
-
-	size = (size + 3) & ~3;
-//
-// scan through the block list looking for the first free block
-// of sufficient size, throwing out any purgable blocks along the way
-//
+	int32_t		bin, i;
+	uint32_t	walk;
+	memblock_t	*new, *base;
+	memblock_t	*first, *before;
+
+	size = ZONEROUND(size);
+	if (size < (int32_t)sizeof(freelinks_t))
+		size = sizeof(freelinks_t);	// room for the links when it's freed
 	size += sizeof(memblock_t);	// account for size of block header
-	
-	
+	walk = 0;
+
 //
-// if there is a free block behind the rover, back up over them
+// take the first fitting free block of the size class, or the first block
+// of a larger class, every block of those fits
 //
-	base = mainzone->rover;
-	if (!base->prev->user)
-		base = base->prev;
-	
-	rover = base;
-	start = base->prev;
-	
-	do
+	bin = Z_SizeBin (size);
+	for (base = mainzone->freebins[bin], i = 0; base && i < MAXBINWALK; base = FREELINKS(base)->next, i++)
 	{
-		if (rover == start)		// scanned all the way around the list
-			I_Error("Z_Malloc: failed on allocation of %i bytes", size);
-		if (rover->user)
+		walk++;
+		if (base->size >= size)
+			goto found;
+	}
+	for (bin++ ; bin < NUMBINS ; bin++)
+		if ((base = mainzone->freebins[bin]) != NULL)
 		{
-			if (rover->tag < PU_PURGELEVEL)
-			// hit a block that can't be purged, so move base past it
-				base = rover = rover->next;
-			else
-			{
-			// free the rover block (adding the size to base)
-				base = base->prev;	// the rover can be the base block
-				Z_Free ((byte *)rover+sizeof(memblock_t));
-				base = base->next;
-				rover = base->next;
-			}
+			walk++;
+			goto found;
 		}
-		else
-			rover = rover->next;
-	} while (base->user || base->size < size);
-	
+
+//
+// find a run of free and purgable blocks that is big enough around the
+// least recently used block, the purge hook finishes whatever may still
+// point into the blocks that are thrown out
+//
+	if (purgehook)
+		purgehook ();
+	first = Z_FindPurgeRun (size, &walk);
+	if (!first)
+		I_Error("Z_Malloc: failed on allocation of %i bytes", size);
+
+//
+// throw out the purgable blocks of the run, they merge into base
+//
+	before = first->prev;
+	base = first;
+	while (base->user || base->size < size)
+	{
+		Z_Purge (base->user ? base : base->next);
+		base = before->user ? before->next : before;
+	}
+
 //
 // found a block big enough
 //
+found:
+	Z_UnlinkFree (base);
 	extra = base->size - size;
 	if (extra >  MINFRAGMENT)
 	{	// there will be a free fragment after the allocated block
@@ -195,6 +376,7 @@ void *Z_Malloc (int32_t size, int32_t tag, void *user)
 		new->next->prev = new;
 		base->next = new;
 		base->size = size;
+		Z_LinkFree (new);
 	}
 	
 	if (user)
@@ -209,14 +391,94 @@ void *Z_Malloc (int32_t size, int32_t tag, void *user)
 		base->user = (void *)2;		// mark as in use, but unowned	
 	}
 	base->tag = tag;
+	if (tag >= PU_PURGELEVEL)
+		Z_LinkCache (base);
 	
-	mainzone->rover = base->next;	// next allocation will start looking here
+	zonestats.mallocs++;
+	zonestats.walked += walk;
+	if (zonestats.maxwalk < walk)
+		zonestats.maxwalk = walk;
+	zonestats.tagbytes[tag] += base->size;
 	
 	base->id = ZONEID;
 	return (void *) ((byte *)base + sizeof(memblock_t));
 }
 
 
+/*
+========================
+=
+= Z_MallocLevel
+=
+= Bump allocator for level data that is never freed on its own.
+= The chunks are PU_LEVEL blocks, so Z_FreeTags frees the whole arena
+= on level change. Only the current chunk is owned by arenachunk,
+= so it's cleared when the arena is freed.
+=
+========================
+*/
+
+#define ARENACHUNK	0x4000
+
+static byte		*arenachunk;
+static int32_t	arenaused, arenasize;
+
+static void Z_TrimBlock (memblock_t *block, int32_t size)
+{
+	memblock_t	*new, *other;
+
+	if (block->size - size <= MINFRAGMENT)
+		return;
+
+	zonestats.tagbytes[block->tag] -= block->size - size;
+	new = (memblock_t *) ((byte *)block + size);
+	new->size = block->size - size;
+	new->user = NULL;		// free block
+	new->tag = 0;
+	new->id = 0;
+	new->prev = block;
+	new->next = block->next;
+	new->next->prev = new;
+	block->next = new;
+	block->size = size;
+
+	other = new->next;
+	if (!other->user)
+	{	// merge the next free block onto the end
+		Z_UnlinkFree (other);
+		new->size += other->size;
+		new->next = other->next;
+		new->next->prev = new;
+	}
+
+	Z_LinkFree (new);
+}
+
+void *Z_MallocLevel (int32_t size)
+{
+	memblock_t	*block;
+	byte		*ptr;
+
+	size = ZONEROUND(size);
+
+	if (!arenachunk || arenaused + size > arenasize)
+	{
+		if (arenachunk)
+		{	// give the unused end back, and the chunk is no longer the current one
+			block = (memblock_t *) (arenachunk - sizeof(memblock_t));
+			block->user = (void *)2;
+			Z_TrimBlock (block, ZONEROUND((int32_t)sizeof(memblock_t) + arenaused));
+		}
+		arenasize = size > ARENACHUNK ? size : ARENACHUNK;
+		arenaused = 0;
+		Z_Malloc (arenasize, PU_LEVEL, &arenachunk);
+	}
+
+	ptr = arenachunk + arenaused;
+	arenaused += size;
+	return ptr;
+}
+
 /*
 ========================
 =
@@ -251,7 +513,13 @@ void Z_FreeTags (int32_t lowtag, int32_t hightag)
 void Z_CheckHeap (void)
 {
 	memblock_t	*block;
-	
+	int32_t		bin;
+
+	for (bin = 0; bin < NUMBINS; bin++)
+		for (block = mainzone->freebins[bin]; block; block = FREELINKS(block)->next)
+			if (block->user || Z_SizeBin (block->size) != bin)
+				I_Error ("Z_CheckHeap: bad block on the free list\n");
+
 	for (block = mainzone->blocklist.next ; ; block = block->next)
 	{
 		if (block->next == &mainzone->blocklist)
@@ -281,7 +549,124 @@ void Z_ChangeTag2 (void *ptr, int32_t tag)
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID)
 		I_Error ("Z_ChangeTag: freed a pointer without ZONEID");
-	if (tag >= PU_PURGELEVEL && (uint32_t)block->user < 0x100)
+	if (tag >= PU_PURGELEVEL && (uintptr_t)block->user < 0x100)
 		I_Error ("Z_ChangeTag: an owner is required for purgable blocks");
+	zonestats.tagbytes[block->tag] -= block->size;
+	zonestats.tagbytes[tag] += block->size;
+	if (block->tag >= PU_PURGELEVEL)
+		Z_UnlinkCache (block);
 	block->tag = tag;
+	if (tag >= PU_PURGELEVEL)
+		Z_LinkCache (block);
+}
+
+
+/*
+========================
+=
+= Z_Touch
+=
+= Puts a purgable block that's used without changing its tag
+= at the end of the cache list
+=
+========================
+*/
+
+void Z_Touch (void *ptr)
+{
+	memblock_t	*block;
+
+	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+	if (block->tag >= PU_PURGELEVEL && block->lrunext != &mainzone->cachelist)
+	{
+		Z_UnlinkCache (block);
+		Z_LinkCache (block);
+	}
+}
+
+
+/*
+========================
+=
+= Z_DumpHeap
+=
+= Writes the counters and a map of the zone, one character per cell
+=
+========================
+*/
+
+#define MAPWIDTH	64
+#define MAPHEIGHT	32
+
+static char Z_BlockChar (memblock_t *block)
+{
+	if (!block->user)
+		return '.';
+	if (block->tag == PU_STATIC)
+		return '#';
+	if (block->tag < PU_LEVEL)
+		return 's';		// sound, music and Dave
+	if (block->tag == PU_LEVEL)
+		return 'L';
+	if (block->tag < PU_PURGELEVEL)
+		return 'T';		// special thinkers
+	if (block->tag < PU_CACHE)
+		return 'p';
+	return 'C';
+}
+
+void Z_DumpHeap (char *filename)
+{
+	FILE		*fp;
+	memblock_t	*block;
+	int32_t		numblocks, numfree, freebytes, largest;
+	int32_t		cellsize, cell, tag;
+	byte		*cellstart, *zonestart;
+
+	fp = fopen (filename, "w");
+	if (!fp)
+		return;
+
+	numblocks = numfree = freebytes = largest = 0;
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+	{
+		numblocks++;
+		if (block->user)
+			continue;
+		numfree++;
+		freebytes += block->size;
+		if (largest < block->size)
+			largest = block->size;
+	}
+
+	fprintf (fp, "zone: %i bytes, %i blocks\n", mainzone->size, numblocks);
+	fprintf (fp, "free: %i bytes in %i blocks, largest %i\n", freebytes, numfree, largest);
+	fprintf (fp, "Z_Malloc: %u calls, %u blocks walked, max %u\n",
+		zonestats.mallocs, zonestats.walked, zonestats.maxwalk);
+	fprintf (fp, "Z_Free: %u calls\n", zonestats.frees);
+	fprintf (fp, "purged: %u cache blocks, %u bytes\n", zonestats.purges, zonestats.purgedbytes);
+	fprintf (fp, "bytes per tag:\n");
+	for (tag = 0; tag <= PU_CACHE; tag++)
+		if (zonestats.tagbytes[tag])
+			fprintf (fp, "%5i %9i\n", tag, zonestats.tagbytes[tag]);
+
+	cellsize = (mainzone->size + MAPWIDTH * MAPHEIGHT - 1) / (MAPWIDTH * MAPHEIGHT);
+	fprintf (fp, "\nmap, %i bytes per character: . free  # static  s sound  L level  T thinker  p/C cache\n", cellsize);
+
+	zonestart = (byte *)mainzone;
+	block = mainzone->blocklist.next;
+	for (cell = 0; cell < MAPWIDTH * MAPHEIGHT; cell++)
+	{
+		cellstart = zonestart + cell * cellsize;
+		while (block != &mainzone->blocklist && (byte *)block + block->size <= cellstart)
+			block = block->next;
+		if (block == &mainzone->blocklist)
+			break;
+		fputc (Z_BlockChar (block), fp);
+		if (cell % MAPWIDTH == MAPWIDTH - 1)
+			fputc ('\n', fp);
+	}
+	fputc ('\n', fp);
+
+	fclose (fp);
 }